@@ -22,6 +22,7 @@
 #include "alignment.h"
 #include <string>
 #include <stdlib.h>
+#include <limits.h>
 using namespace std;
 
 // ============================================================================
@@ -66,12 +67,159 @@ int AlignmentJan::align(const string& s1, const string& s2)
         return (*this)(s1.length(), s2.length());
 }
 
+int AlignmentJan::alignScore(const string& s1, const string& s2)
+{
+        const int len1 = s1.length(), len2 = s2.length();
+        const int W = 2 * maxIndel + 1;
+        const int minusInf = INT_MIN / 2;
+
+        // the cell (i, j) is stored at l = j - i + maxIndel of row i; the
+        // element at l = W is a sentinel for the deletion of the last diagonal
+        int *prev = band, *curr = band + W + 1;
+
+        for (int l = 0; l <= W; l++) {
+                int j = l - maxIndel;
+                prev[l] = (j >= 0 && l < W) ? j * gap : minusInf;
+                curr[l] = minusInf;
+        }
+
+        for (int i = 1; i <= len1; i++) {
+                const char c1 = s1[i-1];
+                const bool wildcard = (c1 == 'N');
+
+                // diagonals of this row with 1 <= j <= len2; the cells
+                // outside them are not read unless they hold the border
+                // or the sentinel, so they need not be reset
+                int first = max(0, maxIndel - i + 1);
+                int last = min(W - 1, len2 - i + maxIndel);
+                if (i <= maxIndel)
+                        curr[maxIndel - i] = i * gap;
+
+                // match and deletion only depend on the previous row
+                const char *c2 = s2.data();
+                const int offset = i - maxIndel - 1;
+                for (int l = first; l <= last; l++) {
+                        const char c = c2[offset + l];
+                        bool hit = (c1 == c) | wildcard | (c == 'N');
+                        int thisMatch = prev[l] + ((hit) ? match : mismatch);
+                        int thisDel = prev[l+1] + gap;
+                        curr[l] = max(thisMatch, thisDel);
+                }
+
+                // insertions run along the row
+                for (int l = max(first, 1); l <= last; l++)
+                        curr[l] = max(curr[l], curr[l-1] + gap);
+
+                swap(prev, curr);
+        }
+
+        int l = len2 - len1 + maxIndel;
+        return (l >= 0 && l < W) ? prev[l] : minusInf;
+}
+
+void AlignmentJan::alignBatch(const string& s1, size_t offset,
+                              const string& s2, const vector<size_t>& s2First,
+                              vector<int>& scores)
+{
+        const int B = ALIGNMENT_BATCH_SIZE;
+        const int W = 2 * maxIndel + 1;
+        const short minusInf = SHRT_MIN / 2;
+        const int maxStep = max(abs(match), max(abs(mismatch), abs(gap)));
+
+        const size_t numTotal = s2First.size() - 1;
+        scores.resize(numTotal);
+        for (size_t c0 = 0; c0 < numTotal; c0 += B) {
+                int numCand = min<size_t>(B, numTotal - c0);
+
+                int len[B], maxLen = 0;
+                for (int c = 0; c < B; c++) {
+                        len[c] = (c < numCand) ? s2First[c0+c+1] - s2First[c0+c] : -1;
+                        maxLen = max(maxLen, len[c]);
+                }
+
+                // the lanes hold 16-bit scores: align long windows one by one
+                if ((maxLen + maxIndel + 1) * maxStep >= -minusInf) {
+                        for (int c = 0; c < numCand; c++)
+                                scores[c0+c] = alignScore(s1.substr(offset, len[c]),
+                                                          s2.substr(s2First[c0+c], len[c]));
+                        continue;
+                }
+
+                // the character j of candidate c is stored at j * B + c;
+                // unused lanes and positions are filled with the wildcard
+                batchSeq.assign(maxLen * B, 'N');
+                for (int c = 0; c < numCand; c++) {
+                        const char *cand = s2.data() + s2First[c0+c];
+                        for (int j = 0; j < len[c]; j++)
+                                batchSeq[j * B + c] = cand[j];
+                }
+
+                // same layout as alignScore(), with B lanes per cell; the
+                // cells beyond the end of a candidate do not contribute to
+                // its score, so all lanes are processed up to maxLen
+                short *prev = batchBand, *curr = batchBand + (W + 1) * B;
+                for (int l = 0; l <= W; l++) {
+                        int j = l - maxIndel;
+                        for (int c = 0; c < B; c++) {
+                                prev[l*B + c] = (j >= 0 && l < W) ? j * gap : minusInf;
+                                curr[l*B + c] = minusInf;
+                        }
+                }
+
+                for (int c = 0; c < numCand; c++)
+                        if (len[c] == 0)
+                                scores[c0+c] = prev[maxIndel*B + c];
+
+                for (int i = 1; i <= maxLen; i++) {
+                        const short c1 = s1[offset + i - 1];
+                        const short wildcard = (c1 == 'N');
+
+                        int first = max(0, maxIndel - i + 1);
+                        int last = min(W - 1, maxLen - i + maxIndel);
+                        if (i <= maxIndel)
+                                for (int c = 0; c < B; c++)
+                                        curr[(maxIndel - i)*B + c] = i * gap;
+
+                        // the left neighbours are kept in left[] and the
+                        // substitution score is computed without a branch,
+                        // so that the lanes of a cell vectorize
+                        short left[B];
+                        for (int c = 0; c < B; c++)
+                                left[c] = (first > 0) ? curr[(first-1)*B + c] : minusInf;
+
+                        const int jOffset = i - maxIndel - 1;
+                        for (int l = first; l <= last; l++) {
+                                const short *c2 = &batchSeq[(jOffset + l) * B];
+                                const short *diag = prev + l*B, *up = prev + (l+1)*B;
+                                short *cell = curr + l*B;
+                                for (int c = 0; c < B; c++) {
+                                        short hit = (c1 == c2[c]) | wildcard | (c2[c] == 'N');
+                                        short thisMatch = diag[c] + mismatch + hit * (match - mismatch);
+                                        short thisDel = up[c] + gap;
+                                        short thisIns = left[c] + gap;
+                                        short best = max(thisMatch, max(thisDel, thisIns));
+                                        left[c] = best;
+                                        cell[c] = best;
+                                }
+                        }
+
+                        for (int c = 0; c < numCand; c++)
+                                if (len[c] == i)
+                                        scores[c0+c] = curr[maxIndel*B + c];
+
+                        swap(prev, curr);
+                }
+        }
+}
+
 AlignmentJan::AlignmentJan(int maxDim_, int maxIndel_, int match_,
                            int mismatch_, int gap_) : maxDim(maxDim_),
                            maxIndel(maxIndel_), match(match_),
                            mismatch(mismatch_), gap(gap_)
 {
         M = new int[(2*maxIndel+1) * (maxDim+1)];
+        band = new int[2 * (2*maxIndel+2)];
+        batchBand = new short[2 * (2*maxIndel+2) * ALIGNMENT_BATCH_SIZE];
 }
 
 void AlignmentJan::printMatrix() const
@@ -26,6 +26,7 @@
 #include "global.h"
 #include "tstring.h"
 #include <iostream>
+#include <vector>
 
 using namespace std;
 
@@ -42,6 +43,9 @@ private:
         int mismatch;           // mismatch penalty
         int gap;                // gap score
         int *M;                 // alignment matrix
+        int *band;              // two rows of the band (alignScore)
+        short *batchBand;       // two rows of the band per lane (alignBatch)
+        std::vector<short> batchSeq;    // candidates per lane (alignBatch)
 
         // void traceback(string& s1,string& s2,char **traceback );
         // void init();
@@ -63,6 +67,8 @@ public:
          */
         ~AlignmentJan() {
                 delete [] M;
+                delete [] band;
+                delete [] batchBand;
         }
 
         int operator() (int i, int j) const {
@@ -85,6 +91,35 @@ public:
          */
         int align(const string &s1, const string &s2);
 
+        /**
+         * Compute the alignment score without filling the alignment matrix.
+         * Yields the same score as align() but processes the band row by
+         * row, one diagonal per element, without branches in the inner loop.
+         * Sequences whose lengths differ by more than maxIndel cannot be
+         * aligned within the band: the score is then INT_MIN / 2.
+         * @param s1 First string
+         * @param s2 Second string
+         * @return The alignment score (higher is better)
+         */
+        int alignScore(const string &s1, const string &s2);
+
+        /**
+         * Compute the alignment scores of a window of s1 against a number of
+         * candidates at once. The candidates are stored back to back in s2:
+         * candidate c is s2[s2First[c], s2First[c+1]) and is aligned with the
+         * window of the same length that starts at offset in s1.
+         * ALIGNMENT_BATCH_SIZE candidates are processed together, one per
+         * 16-bit lane, in a single pass over the window; windows too long for
+         * 16-bit scores are aligned one by one.
+         * @param s1 Sequence that holds the window
+         * @param offset Start of the window in s1
+         * @param s2 Concatenated candidate sequences
+         * @param s2First Start of each candidate in s2, followed by the end
+         * @param scores Alignment scores, one per candidate (output)
+         */
+        void alignBatch(const string &s1, size_t offset, const string &s2,
+                        const vector<size_t> &s2First, vector<int> &scores);
+
         /**
          * Print matrix to stdout
          */
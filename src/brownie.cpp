@@ -59,25 +59,24 @@ void Brownie::parameterEstimationInStage4(DBGraph &graph){
         readLength = libraries.getAvgReadLength();
         if (readLength <= settings.getK() || readLength > 500)
                 readLength = 150;
-        cout << "Loading test graph for initial parameter estimation" << endl;
+        cout << "Cloning graph for initial parameter estimation" << endl;
         DBGraph testgraph(settings);
-        testgraph.loadGraphBin(getBinNodeFilename(3),
-                               getBinArcFilename(3),
-                               getMetaDataFilename(3));
+        testgraph.cloneFrom(graph);
         testgraph.readLength = readLength;
         #ifdef DEBUG
         testgraph.compareToSolution(getTrueMultFilename(3), true);
         #endif
         testgraph.clipTips(0);
-        testgraph.mergeSingleNodes(true);
+        testgraph.mergeChains();
         testgraph.filterCoverage(testgraph.cutOffvalue);
-        testgraph.mergeSingleNodes(true);
+        testgraph.mergeChains();
         testgraph.extractStatistic(0);
         cout << "Estimated Kmer coverage mean: " << testgraph.estimatedKmerCoverage << endl;
         cout << "Estimated Kmer coverage std:  " << testgraph.estimatedMKmerCoverageSTD << endl;
 
         estimatedKmerCoverage = testgraph.estimatedKmerCoverage;
         estimatedMKmerCoverageSTD = testgraph.estimatedMKmerCoverageSTD;
+        double readStartCovPerBase = testgraph.readStartCovPerBase;
         double estimatedErroneousKmerCoverage = 1+ estimatedKmerCoverage/100;
         double e = 2.718281;
         double c = estimatedErroneousKmerCoverage/estimatedKmerCoverage;
@@ -88,11 +87,13 @@ void Brownie::parameterEstimationInStage4(DBGraph &graph){
                 cutOffvalue = (estimatedErroneousKmerCoverage-estimatedKmerCoverage)* (log(e)/log(c));
         testgraph.updateGraphSize();
         testgraph.clear();
+        graph.activate();
            //initialize values for graph parameter based on test graph.
         graph.estimatedKmerCoverage = estimatedKmerCoverage;
         graph.estimatedMKmerCoverageSTD = estimatedMKmerCoverageSTD;
         graph.cutOffvalue = cutOffvalue;
         graph.readLength = readLength;
+        graph.readStartCovPerBase = readStartCovPerBase;
         graph.maxNodeSizeToDel = readLength*4;
         graph.redLineValueCov = cutOffvalue;
         graph.certainVlueCov = cutOffvalue*.3;
@@ -230,9 +231,7 @@ void Brownie::stageThree()
         cout << "Done counting multiplicity (" << Util::stopChronoStr() << ")" << endl;
 
         cout << "Extracting graph..." << endl;
-        graph.writeGraphBin(getBinNodeFilename(3),
-                            getBinArcFilename(3),
-                            getMetaDataFilename(3));
+        graph.writeGraphBin(getBinGraphFilename(3));
 
 #ifdef DEBUG
         graph.sanityCheck();
@@ -254,31 +253,53 @@ void Brownie::stageFour()
                  return;
         }
         DBGraph graph(settings);
-        parameterEstimationInStage4( graph );
-
-        Util::startChrono();
-        cout << "Creating graph... ";
-        graph.loadGraphBin(getBinNodeFilename(3),
-                           getBinArcFilename(3),
-                           getMetaDataFilename(3));
-
-
-        cout.flush();
-        cout << "done (" << graph.getNumNodes() << " nodes, "
-             << graph.getNumArcs() << " arcs)" << endl;
-        cout << "Created graph in "
-             << Util::stopChrono() << "s." << endl;
+        // component purification runs each subgraph from round 1 and
+        // writes no checkpoints: it never resumes from a whole-graph
+        // checkpoint, which is removed once the stage completes
+        graph.enableCheckpoints(getCheckpointPrefix(),
+                readGraphBinChecksum(getBinGraphFilename(3)),
+                settings.getComponentPurification() ?
+                CHECKPOINT_MODE_COMPONENT : CHECKPOINT_MODE_GRAPH);
+
+        // resume from a checkpoint of an interrupted run, if any
+        int lastRound = graph.loadCheckpoint();
+        if (lastRound > 0) {
+                cout << "Resuming graph purification after round "
+                     << lastRound << " (" << graph.getNumNodes() << " nodes, "
+                     << graph.getNumArcs() << " arcs)" << endl;
+        } else {
+                Util::startChrono();
+                cout << "Creating graph... ";
+                graph.loadGraphBin(getBinGraphFilename(3));
+
+
+                cout.flush();
+                cout << "done (" << graph.getNumNodes() << " nodes, "
+                     << graph.getNumArcs() << " arcs)" << endl;
+                cout << "Created graph in "
+                     << Util::stopChrono() << "s." << endl;
+
+                parameterEstimationInStage4( graph );
+        }
 
 #ifdef DEBUG
-        graph.compareToSolution(getTrueMultFilename(3), true);
+        // a checkpoint holds the true multiplicities in its own numbering,
+        // the stage 3 file is only rebuilt for the stage 3 graph
+        graph.compareToSolution(getTrueMultFilename(3), lastRound == 0);
 #endif
         Util::startChrono();
-        graph.graphPurification(getTrueMultFilename(3), libraries);
+        if (settings.getComponentPurification())
+                graph.componentPurification(libraries);
+        else
+                graph.graphPurification(getTrueMultFilename(3), libraries,
+                                        lastRound + 1);
 #ifdef DEBUG
         graph.compareToSolution(getTrueMultFilename(3), false);
 #endif
         cout << "Graph size: " << graph.sizeOfGraph << " bp" << endl;
         graph.writeGraph(getNodeFilename(4),getArcFilename(4),getMetaDataFilename(4));
+        graph.writeGraphBin(getBinGraphFilename(4));
+        graph.removeCheckpoints();
         cout<<"N50 is: "<<graph.n50<<endl;
         cout << "Graph correction completed in "
              << Util::stopChrono() << "s." << endl;
@@ -302,13 +323,11 @@ void Brownie::stageFive()
                 return;
         }
 
-        // Build a DBG from stage 4 files on disk
+        // Load the DBG from the stage 4 binary graph file
         DBGraph graph(settings);
         Util::startChrono();
         cout << "Creating graph... "; cout.flush();
-        graph.createFromFile(getNodeFilename(4),
-                             getArcFilename(4),
-                             getMetaDataFilename(4));
+        graph.loadGraphBin(getBinGraphFilename(4));
         cout << "done (" << Util::stopChronoStr() << ")" << endl;
         cout << "Graph contains " << graph.getNumNodes() << " nodes and "
              << graph.getNumArcs() << " arcs" << endl;
@@ -332,17 +351,13 @@ void Brownie::writeGraphFasta()
 {
         DBGraph graph(settings);
         if (settings.getSkipStage4()) {
-                graph.loadGraphBin(getBinNodeFilename(3),
-                        getBinArcFilename(3),
-                        getMetaDataFilename(3));
+                graph.loadGraphBin(getBinGraphFilename(3));
                 graph.writeGraph(getNodeFilename(4),
                                  getArcFilename(4),
                                  getMetaDataFilename(4));
                 graph.writeGraphFasta();
         } else if (settings.getSkipStage5()) {
-                graph.createFromFile(getNodeFilename(4),
-                        getArcFilename(4),
-                        getMetaDataFilename(4));
+                graph.loadGraphBin(getBinGraphFilename(4));
                 graph.writeGraphFasta();
         }
         graph.clear();
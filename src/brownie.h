@@ -96,23 +96,21 @@ public:
         }
 
         /**
-         * Get the binary node filename
-         * @return String containing the binary node filename
+         * Get the binary graph filename
+         * @return String containing the binary graph filename
          */
-        std::string getBinNodeFilename(int filestage) const {
+        std::string getBinGraphFilename(int filestage) const {
                 char stageStr[4];
                 sprintf(stageStr, "%d", filestage);
-                return settings.addTempDirectory("nodes.bin.stage") + stageStr;
+                return settings.addTempDirectory("graph.bin.stage") + stageStr;
         }
 
         /**
-         * Get the binary arc filename
-         * @return String containing the binary arc filename
+         * Get the prefix of the stage 4 checkpoint files
+         * @return String containing the checkpoint filename prefix
          */
-        std::string getBinArcFilename(int filestage) const {
-                char stageStr[4];
-                sprintf(stageStr, "%d", filestage);
-                return settings.addTempDirectory("arcs.bin.stage") + stageStr;
+        std::string getCheckpointPrefix() const {
+                return settings.addTempDirectory("checkpoint.stage4");
         }
 
         /**
@@ -168,11 +166,7 @@ public:
          * @return True or false
          */
         bool stageThreeNecessary() const {
-                if (!Util::fileExists(getBinNodeFilename(3)))
-                        return true;
-                if (!Util::fileExists(getBinArcFilename(3)))
-                        return true;
-                return !Util::fileExists(getMetaDataFilename(3));
+                return !Util::fileExists(getBinGraphFilename(3));
         }
 
         /**
@@ -186,7 +180,9 @@ public:
                         return true;
                 if (!Util::fileExists(getArcFilename(4)))
                         return true;
-                return !Util::fileExists(getMetaDataFilename(4));
+                if (!Util::fileExists(getMetaDataFilename(4)))
+                        return true;
+                return !Util::fileExists(getBinGraphFilename(4));
         }
 
         /**
@@ -201,7 +197,7 @@ public:
         /**
          * estimate kmer NodeKmerCoverageMean and STD with manipulating a test graph.
          * this routine estimates initial parameters for the graph
-         * by making a test graph.
+         * by manipulating a copy-on-write clone of the loaded graph.
          * @param @graph The acutal graph which later will be cleand in this stage. Initial parameters of this
          * graph will be set in this routine based on a test graph manipulation.
          */
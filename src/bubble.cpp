@@ -23,24 +23,11 @@
 #include "settings.h"
 #include "library.h"
 
-#include <queue>
+#include <thread>
+#include <functional>
+#include <iterator>
 
 using namespace std;
-class PathInfo {
-public:
-        NodeID nodeID;
-        size_t length;
-
-        PathInfo(NodeID nodeID, size_t length) : nodeID(nodeID), length(length) {};
-};
-
-struct comparator {
-
-         bool operator()(const PathInfo& f, const PathInfo& s)
-        {
-                return f.length >= s.length;
-        }
-};
 
 bool DBGraph::removeBubble(SSNode &prevFirstNode ,SSNode& extendFirstNode,size_t &TP,size_t &TN,size_t &FP,size_t &FN,size_t & numOfDel ){
         bool preIsSingle=true;
@@ -256,29 +243,19 @@ bool DBGraph::whichOneIsbubble(SSNode rootNode,bool &first, SSNode &prevFirstNod
         return false;
 }
 
-void DBGraph::extractPath(NodeID currID, const vector<NodeID>& prevNode) const
+void DBGraph::extractPath(NodeID currID, const TraversalWorkspace& ws) const
 {
-        vector<NodeID> path;
-        path.push_back(currID);
-
-        while (true) {
-                currID = prevNode[currID + numNodes];
-                if (currID == 0)
-                        break;
-                path.push_back(currID);
-        }
-
-        reverse(path.begin(), path.end());
+        vector<NodeID> path = getPath(currID, ws);
         for (auto it : path)
                 cout << it << " ";
 }
-vector<NodeID> DBGraph::getPath(NodeID currID, const vector<NodeID>& prevNode) const
+vector<NodeID> DBGraph::getPath(NodeID currID, const TraversalWorkspace& ws) const
 {
         vector<NodeID> path;
         path.push_back(currID);
 
         while (true) {
-                currID = prevNode[currID + numNodes];
+                currID = ws.getPrevNode(currID);
                 if (currID == 0)
                         break;
                 path.push_back(currID);
@@ -288,18 +265,19 @@ vector<NodeID> DBGraph::getPath(NodeID currID, const vector<NodeID>& prevNode) c
         return path;
 }
 
-vector<pair<vector<NodeID>, vector<NodeID> > >  DBGraph::searchForParallelNodes(SSNode node,vector<NodeID> &visited, vector<NodeID> &prevNode,vector<NodeID> &nodeColor, int depth){
+vector<pair<vector<NodeID>, vector<NodeID> > >  DBGraph::searchForParallelNodes(SSNode node, TraversalWorkspace& ws, int depth, vector<size_t>* closeDepth){
         size_t maxLength = depth;
         NodeID lID=node.getNodeID();
-        priority_queue<PathInfo, vector<PathInfo>, comparator> heap;
-        heap.push(PathInfo(lID, 0));
+        // the path lengths are bounded by depth: use a bucket queue
+        BucketQueue<NodeID>& queue = ws.getQueue();
+        queue.reset(maxLength);
+        queue.push(0, lID);
         vector<pair<vector<NodeID>, vector<NodeID> > > parallelNodes;
         size_t visitedNodesLimit = settings.getBubbleDFSNodeLimit();
-        while(!heap.empty()) {
-                PathInfo currTop = heap.top();
-                heap.pop();
-                NodeID currID = currTop.nodeID;
-                size_t currLength = currTop.length;
+        ws.reset();
+        while(!queue.empty()) {
+                size_t currLength;
+                NodeID currID = queue.pop(currLength);
                 SSNode curr = getSSNode(currID);
                 if (!curr.isValid())
                         continue;
@@ -308,90 +286,171 @@ vector<pair<vector<NodeID>, vector<NodeID> > >  DBGraph::searchForParallelNodes(
                         SSNode next = getSSNode(nextID);
 
                         // do we encounter a node previously encountered?
-                        if ((prevNode[nextID + numNodes] != 0) || (nextID == lID)) {
-                                if (nodeColor[nextID + numNodes] == nodeColor[currID + numNodes])
+                        if (ws.isVisited(nextID) || (nextID == lID)) {
+                                if (ws.getColor(nextID) == ws.getColor(currID))
                                         continue;
 
-                                NodeID upNodeID=nodeColor[currID + numNodes];
-                                NodeID downNodeID=nodeColor[nextID + numNodes];
+                                NodeID upNodeID=ws.getColor(currID);
+                                NodeID downNodeID=ws.getColor(nextID);
                                 if (upNodeID!=0&&downNodeID!=0){
-                                        vector<NodeID> upPathElements=getPath(currID, prevNode);
-                                        vector<NodeID> downPathElements=getPath(nextID, prevNode);
+                                        vector<NodeID> upPathElements=getPath(currID, ws);
+                                        vector<NodeID> downPathElements=getPath(nextID, ws);
                                         parallelNodes.push_back(make_pair(upPathElements,downPathElements));
+                                        if (closeDepth != NULL)
+                                                closeDepth->push_back(currLength);
                                 }
 
                         } else {
-                                prevNode[nextID + numNodes] = currID;
-                                nodeColor[nextID + numNodes] = (currID == lID) ? nextID : nodeColor[currID + numNodes];
-                                visited.push_back(nextID);
+                                ws.visit(nextID, currID, (currID == lID) ? nextID : ws.getColor(currID));
 
                                 size_t nextLength = currLength + next.getMarginalLength();
                                 if (nextLength > maxLength)
                                         continue;
-                                if (visited.size()>visitedNodesLimit)
+                                if (ws.getVisited().size()>visitedNodesLimit)
                                         continue;
-                                PathInfo nextTop(nextID, nextLength);
-                                heap.push(nextTop);
+                                queue.push(nextLength, nextID);
                         }
                 }
         }
 
-       for (auto it : visited) {
-                prevNode[it + numNodes] = 0;
-                nodeColor[it + numNodes] = 0;
-        }
-        visited.clear();
-
         return parallelNodes;
 }
 vector<pair<vector<NodeID>, vector<NodeID>> >  DBGraph::searchForParallelNodes(SSNode node, int depth){
-        vector<NodeID> prevNode(2*numNodes+1, 0);
-        vector<NodeID> nodeColor(2*numNodes+1, 0);
-        vector<NodeID> visited;
-        return (searchForParallelNodes(node, visited,nodeColor,prevNode, depth));
+        prepareWorkspaces(1);
+        return (searchForParallelNodes(node, getWorkspace(0), depth));
 }
-bool DBGraph::bubbleDetection(int depth) {
 
-        size_t numOfDel=0;
-        size_t TP=0,TN=0,FP=0,FN=0;
-        vector<NodeID> prevNode(2*numNodes+1, 0);
-        vector<NodeID> nodeColor(2*numNodes+1, 0);
-        vector<pair<NodeID, NodeID> > parallelNodes;
-        vector<NodeID> visited;
-        for (NodeID lID = -numNodes; lID <numNodes; lID++) {
-                if (lID % OUTPUT_FREQUENCY == 0)
-                        (cout << "Extracting node -" <<numNodes<< "/ "<<lID<<" /"<<numNodes
-                        << " from graph          \r").flush();
+/**
+ * Record the modification of a node and its neighbours
+ * @param node Node that is about to be removed
+ * @param modifiedAt Per node time of the last modification (output)
+ * @param time Current time
+ */
+static void markModified(SSNode& node, vector<size_t>& modifiedAt, size_t time)
+{
+        modifiedAt[abs(node.getNodeID())] = time;
+        for (ArcIt it = node.leftBegin(); it != node.leftEnd(); it++)
+                modifiedAt[abs(it->getNodeID())] = time;
+        for (ArcIt it = node.rightBegin(); it != node.rightEnd(); it++)
+                modifiedAt[abs(it->getNodeID())] = time;
+}
+
+/**
+ * Order bubble candidates by root identifier
+ * @return True if the first root comes before the second root
+ */
+static bool compareRootID(const BubbleCandidate& first, const BubbleCandidate& second)
+{
+        return first.rootID < second.rootID;
+}
+
+bool DBGraph::isBubbleRoot(NodeID lID)
+{
+        SSNode node = getSSNode(lID);
+        if (!node.isValid())
+                return false;
+        // only consider nodes that branch
+        if (node.getNumRightArcs() < 2)
+                return false;
+        return hasLowCovNode(node);
+}
+
+void DBGraph::searchBubbleCandidate(BubbleCandidate& cand, TraversalWorkspace& ws,
+                                    size_t depth, size_t time)
+{
+        cand.closeDepth.clear();
+        cand.parallelPaths = searchForParallelNodes(getSSNode(cand.rootID), ws,
+                                                    depth, &cand.closeDepth);
+        cand.footprint = ws.getVisited();
+        cand.searchTime = time;
+}
+
+void DBGraph::bubbleSearchThread(size_t myID, size_t numThreads, size_t depth,
+                                 vector<BubbleCandidate>* candidates)
+{
+        activate();
+        TraversalWorkspace& ws = getWorkspace(myID);
+
+        // roots range from -numNodes to numNodes - 1
+        NodeID firstID = -numNodes + (myID * 2 * numNodes) / numThreads;
+        NodeID lastID = -numNodes + ((myID + 1) * 2 * numNodes) / numThreads;
+
+        for (NodeID lID = firstID; lID < lastID; lID++) {
                 if ( lID == 0 )
                         continue;
-                SSNode node = getSSNode(lID);
-                if (!node.isValid())
-                        continue;
-                // only consider nodes that branch
-                if (node.getNumRightArcs() < 2)
+                if (!isBubbleRoot(lID))
                         continue;
-                if (!hasLowCovNode(node))
+
+                candidates->push_back(BubbleCandidate());
+                candidates->back().rootID = lID;
+                searchBubbleCandidate(candidates->back(), ws, depth, 0);
+        }
+}
+
+void DBGraph::findBubbleCandidates(size_t depth, vector<BubbleCandidate>& candidates)
+{
+        // search all roots in parallel on the unmodified graph
+        const size_t numThreads = numWorkerThreads;
+        prepareWorkspaces(numThreads);
+        vector<vector<BubbleCandidate> > threadCandidates(numThreads);
+        vector<thread> workerThreads(numThreads);
+        for (size_t i = 0; i < workerThreads.size(); i++)
+                workerThreads[i] = thread(&DBGraph::bubbleSearchThread, this,
+                                          i, numThreads, depth, &threadCandidates[i]);
+        for_each(workerThreads.begin(), workerThreads.end(), mem_fn(&thread::join));
+
+        // the ranges are consecutive: the candidates are ordered by root
+        candidates.clear();
+        for (size_t i = 0; i < numThreads; i++)
+                move(threadCandidates[i].begin(), threadCandidates[i].end(),
+                     back_inserter(candidates));
+}
+
+size_t DBGraph::removeBubbles(const BubbleCandidate& cand, size_t depth,
+                              vector<size_t>& modifiedAt, size_t& time,
+                              size_t& TP, size_t& TN, size_t& FP, size_t& FN)
+{
+        size_t numOfDel = 0;
+        SSNode root = getSSNode(cand.rootID);
+        for (size_t p = 0; p < cand.parallelPaths.size(); p++){
+                // only the pairs that close within the current depth
+                if (cand.closeDepth[p] > depth)
                         continue;
-                vector<pair<vector<NodeID>, vector<NodeID>> > parallelPath=searchForParallelNodes(node, visited,nodeColor,prevNode, depth);
-                for (auto it : parallelPath){
-
-                        vector<NodeID> upPath=it.first;
-                        vector<NodeID> downPath=it.second;
-
-                        SSNode upLast=getSSNode(it.first[upPath.size()-1]);
-                        SSNode downLast=getSSNode(it.second[downPath.size()-1]);
-                        SSNode up=getSSNode(it.first[1]);
-                        SSNode down=getSSNode(it.second[1]);
-                        if(up.isValid()&&down.isValid())
-                        {
-                                bool upIsBubble=true;
-                                bool bubbleDeleted=false;
-                                if (whichOneIsbubble(node,upIsBubble,up, down,false,this->cutOffvalue)){
-                                        if (upIsBubble){
+                const pair<vector<NodeID>, vector<NodeID> >& it = cand.parallelPaths[p];
+
+                vector<NodeID> upPath=it.first;
+                vector<NodeID> downPath=it.second;
+
+                SSNode upLast=getSSNode(it.first[upPath.size()-1]);
+                SSNode downLast=getSSNode(it.second[downPath.size()-1]);
+                SSNode up=getSSNode(it.first[1]);
+                SSNode down=getSSNode(it.second[1]);
+                if(up.isValid()&&down.isValid())
+                {
+                        bool upIsBubble=true;
+                        bool bubbleDeleted=false;
+                        if (whichOneIsbubble(root,upIsBubble,up, down,false,this->cutOffvalue)){
+                                if (upIsBubble){
+                                        #ifdef DEBUG
+                                        size_t mul=trueMult[abs( up.getNodeID())];
+                                        #endif
+                                        markModified(up, modifiedAt, ++time);
+                                        if (removeNode(up)){
+                                                #ifdef DEBUG
+                                                if (mul>0)
+                                                        FP++;
+                                                else
+                                                        TP++;
+                                                #endif
+                                                bubbleDeleted=true;
+                                                numOfDel++;
+                                        }
+                                        if (upLast.isValid()&&upLast.getNodeKmerCov()<cutOffvalue){//&& node.getNodeKmerCov()/upLast.getNodeKmerCov()>3){
                                                 #ifdef DEBUG
-                                                size_t mul=trueMult[abs( up.getNodeID())];
+                                                mul=trueMult[abs( upLast.getNodeID())];
                                                 #endif
-                                                if (removeNode(up)){
+                                                markModified(upLast, modifiedAt, ++time);
+                                                if (removeNode(upLast)){
                                                         #ifdef DEBUG
                                                         if (mul>0)
                                                                 FP++;
@@ -401,27 +460,29 @@ bool DBGraph::bubbleDetection(int depth) {
                                                         bubbleDeleted=true;
                                                         numOfDel++;
                                                 }
-                                                if (upLast.isValid()&&upLast.getNodeKmerCov()<cutOffvalue){//&& node.getNodeKmerCov()/upLast.getNodeKmerCov()>3){
-                                                        #ifdef DEBUG
-                                                        mul=trueMult[abs( upLast.getNodeID())];
-                                                        #endif
-                                                        if (removeNode(upLast)){
-                                                                #ifdef DEBUG
-                                                                if (mul>0)
-                                                                        FP++;
-                                                                else
-                                                                        TP++;
-                                                                #endif
-                                                                bubbleDeleted=true;
-                                                                numOfDel++;
-                                                        }
-                                                }
                                         }
-                                        else{
+                                }
+                                else{
+                                        #ifdef DEBUG
+                                        size_t mul=trueMult[abs( down.getNodeID())];
+                                        #endif
+                                        markModified(down, modifiedAt, ++time);
+                                        if( removeNode(down)){
+                                                #ifdef DEBUG
+                                                if (mul>0)
+                                                        FP++;
+                                                else
+                                                        TP++;
+                                                #endif
+                                                bubbleDeleted=true;
+                                                numOfDel++;
+                                        }
+                                        if (downLast.isValid()&&downLast.getNodeKmerCov()<cutOffvalue){// && node.getNodeKmerCov()/downLast.getNodeKmerCov()>3){
                                                 #ifdef DEBUG
-                                                size_t mul=trueMult[abs( down.getNodeID())];
+                                                mul=trueMult[abs( downLast.getNodeID())];
                                                 #endif
-                                                if( removeNode(down)){
+                                                markModified(downLast, modifiedAt, ++time);
+                                                if( removeNode(downLast)){
                                                         #ifdef DEBUG
                                                         if (mul>0)
                                                                 FP++;
@@ -431,54 +492,132 @@ bool DBGraph::bubbleDetection(int depth) {
                                                         bubbleDeleted=true;
                                                         numOfDel++;
                                                 }
-                                                if (downLast.isValid()&&downLast.getNodeKmerCov()<cutOffvalue){// && node.getNodeKmerCov()/downLast.getNodeKmerCov()>3){
-                                                        #ifdef DEBUG
-                                                        mul=trueMult[abs( downLast.getNodeID())];
-                                                        #endif
-                                                        if( removeNode(downLast)){
-                                                                #ifdef DEBUG
-                                                                if (mul>0)
-                                                                        FP++;
-                                                                else
-                                                                        TP++;
-                                                                #endif
-                                                                bubbleDeleted=true;
-                                                                numOfDel++;
-                                                        }
-                                                }
+                                        }
 
 
-                                        }
-                                }
-                                if(!bubbleDeleted){
-                                        #ifdef DEBUG
-                                        if (trueMult[abs( up.getNodeID())]>0)
-                                                TN++;
-                                        else
-                                                FN++;
-                                        if (trueMult[abs( down.getNodeID())]>0)
-                                                TN++;
-                                        else
-                                                FN++;
-                                        #endif
                                 }
-
                         }
+                        if(!bubbleDeleted){
+                                #ifdef DEBUG
+                                if (trueMult[abs( up.getNodeID())]>0)
+                                        TN++;
+                                else
+                                        FN++;
+                                if (trueMult[abs( down.getNodeID())]>0)
+                                        TN++;
+                                else
+                                        FN++;
+                                #endif
+                        }
+
+                }
+        }
+        return numOfDel;
+}
+
+size_t DBGraph::commitBubbles(vector<BubbleCandidate>& candidates, size_t depth,
+                              size_t searchDepth, vector<size_t>& modifiedAt,
+                              size_t& time)
+{
+        size_t numOfDel=0;
+        size_t TP=0,TN=0,FP=0,FN=0;
+
+        // commit the removals in order of root. A search is redone if a
+        // node it depended on was modified after the search.
+        TraversalWorkspace& ws = getWorkspace(0);
+        size_t numResearched = 0;
+        for (size_t c = 0; c < candidates.size(); c++) {
+                BubbleCandidate& cand = candidates[c];
+                if (!isBubbleRoot(cand.rootID))
+                        continue;
+
+                bool stale = modifiedAt[abs(cand.rootID)] > cand.searchTime;
+                for (size_t i = 0; !stale && i < cand.footprint.size(); i++)
+                        stale = modifiedAt[abs(cand.footprint[i])] > cand.searchTime;
+
+                if (stale) {
+                        searchBubbleCandidate(cand, ws, searchDepth, time);
+                        numResearched++;
                 }
+
+                numOfDel += removeBubbles(cand, depth, modifiedAt, time, TP, TN, FP, FN);
         }
-        cout<<endl;
+        getLog()<<endl;
         #ifdef DEBUG
+        cout << "Number of searches redone after a removal: " << numResearched << endl;
         cout<<endl<< "TP:     "<<TP<<"        TN:     "<<TN<<"        FP:     "<<FP<<"        FN:     "<<FN<<endl;
         cout << "Sensitivity: ("<<100*((double)TP/(double)(TP+FN))<<"%)"<<endl;
         cout<<"Specificity: ("<<100*((double)TN/(double)(TN+FP))<<"%)"<<endl;
         #endif
         if (numOfDel>0)
-        cout << "Number of deleted nodes based on bubble detection: " << numOfDel << endl;
-        if (numOfDel !=0)
-                return true;
-        return false;
+        getLog() << "Number of deleted nodes based on bubble detection: " << numOfDel << endl;
+        return numOfDel;
+}
+
+
+bool DBGraph::bubbleDetection(int depth) {
+        vector<BubbleCandidate> candidates;
+        findBubbleCandidates(depth, candidates);
+
+        vector<size_t> modifiedAt(numNodes+1, 0);
+        size_t time = 0;
+        return commitBubbles(candidates, depth, depth, modifiedAt, time) > 0;
 }
 
+bool DBGraph::bubbleDetection(const vector<size_t>& depths) {
+        // one search per root at the maximum depth, a pair of parallel
+        // paths is applied at every depth at which it closes
+        const size_t maxDepth = depths.back();
+        vector<BubbleCandidate> candidates;
+        findBubbleCandidates(maxDepth, candidates);
+
+        vector<bool> isRoot(2*numNodes+1, false);
+        for (size_t c = 0; c < candidates.size(); c++)
+                isRoot[candidates[c].rootID + numNodes] = true;
+
+        vector<size_t> modifiedAt(numNodes+1, 0);
+        size_t time = 0;
+        bool firstDeleted = false;
+        for (size_t i = 0; i < depths.size(); i++) {
+                if (i > 0)
+                        getLog() << "Bubble depth: " << depths[i] << endl;
+
+                bool deleted = commitBubbles(candidates, depths[i], maxDepth,
+                                             modifiedAt, time) > 0;
+                if (i == 0)
+                        firstDeleted = deleted;
+                else if (!deleted)
+                        break;
+
+                // the merged nodes and their neighbours are modified, merging
+                // can create new roots on both sides of a merged node
+                vector<NodeID> mergedNodes;
+                mergeChains(&mergedNodes);
+                time++;
+
+                size_t numCandidates = candidates.size();
+                for (size_t m = 0; m < mergedNodes.size(); m++) {
+                        modifiedAt[mergedNodes[m]] = time;
+                        for (int strand = 0; strand < 2; strand++) {
+                                NodeID lID = (strand == 0) ? -mergedNodes[m] : mergedNodes[m];
+                                if (lID == numNodes || isRoot[lID + numNodes])
+                                        continue;
+                                if (!isBubbleRoot(lID))
+                                        continue;
+
+                                // searched when it is committed: searchTime < time
+                                isRoot[lID + numNodes] = true;
+                                candidates.push_back(BubbleCandidate());
+                                candidates.back().rootID = lID;
+                                candidates.back().searchTime = 0;
+                        }
+                }
+                if (candidates.size() > numCandidates)
+                        sort(candidates.begin(), candidates.end(), compareRootID);
+        }
+
+        return firstDeleted;
+}
 
 bool DBGraph::hasLowCovNode(SSNode root){
 
@@ -0,0 +1,117 @@
+/***************************************************************************
+ *   Copyright (C) 2014, 2015 Jan Fostier (jan.fostier@intec.ugent.be)     *
+ *   Copyright (C) 2014, 2015 Mahdi Heydari (mahdi.heydari@intec.ugent.be) *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef BUCKETQUEUE_H
+#define BUCKETQUEUE_H
+
+#include <vector>
+#include <cstddef>
+#include <cassert>
+
+// ============================================================================
+// BUCKET QUEUE CLASS
+// ============================================================================
+
+/**
+ * Monotone priority queue for small integer keys (Dial's algorithm). There
+ * is one bucket per key, elements are popped in increasing order of key and
+ * in FIFO order within a key. Keys pushed must not be smaller than the key
+ * of the last popped element and not larger than the maximum key.
+ */
+template<class T>
+class BucketQueue {
+
+private:
+        std::vector<std::vector<T> > buckets;   // one bucket per key
+        std::vector<size_t> head;               // first unpopped element
+        size_t currKey;                         // smallest non-empty key
+        size_t numElements;                     // number of queued elements
+
+public:
+        /**
+         * Default constructor
+         * @param maxKey Maximum key
+         */
+        BucketQueue(size_t maxKey = 0) : currKey(0), numElements(0) {
+                reset(maxKey);
+        }
+
+        /**
+         * Remove all elements, the memory of the buckets is retained
+         * @param maxKey Maximum key
+         */
+        void reset(size_t maxKey) {
+                for (size_t i = currKey; i < buckets.size(); i++)
+                        buckets[i].clear();
+                if (buckets.size() < maxKey + 1)
+                        buckets.resize(maxKey + 1);
+                head.assign(buckets.size(), 0);
+                currKey = 0;
+                numElements = 0;
+        }
+
+        /**
+         * Add an element to the queue
+         * @param key Key of the element
+         * @param element Element to add
+         */
+        void push(size_t key, const T& element) {
+                assert(key >= currKey && key < buckets.size());
+                buckets[key].push_back(element);
+                numElements++;
+        }
+
+        /**
+         * Remove the element with the smallest key from the queue
+         * @param key Key of the element (output)
+         * @return The element with the smallest key
+         */
+        T pop(size_t& key) {
+                assert(numElements > 0);
+                while (head[currKey] == buckets[currKey].size()) {
+                        buckets[currKey].clear();
+                        head[currKey] = 0;
+                        currKey++;
+                }
+
+                key = currKey;
+                numElements--;
+                return buckets[currKey][head[currKey]++];
+        }
+
+        /**
+         * Check whether the queue is empty
+         * @return True or false
+         */
+        bool empty() const {
+                return numElements == 0;
+        }
+
+        /**
+         * Get the number of elements in the queue
+         * @return The number of elements in the queue
+         */
+        size_t size() const {
+                return numElements;
+        }
+};
+
+#endif
@@ -20,13 +20,38 @@
  ***************************************************************************/
 
 #include "graph.h"
+#include "settings.h"
 
+#include <queue>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <iterator>
 
 using namespace std;
 
+void DBGraph::findTipCandidatesThread(size_t myID, size_t numThreads,
+                                      vector<NodeID>* candidates,
+                                      size_t* numValid) const
+{
+        activate();
+        NodeID firstID = 1 + (myID * numNodes) / numThreads;
+        NodeID lastID = ((myID + 1) * numNodes) / numThreads;
+
+        for (NodeID id = firstID; id <= lastID; id++) {
+                SSNode node = getSSNode(id);
+                if (!node.isValid())
+                        continue;
+                (*numValid)++;
+
+                if (node.getNumLeftArcs() == 0 || node.getNumRightArcs() == 0)
+                        candidates->push_back(id);
+        }
+}
+
 bool DBGraph::clipTips(int round)
 {
-        cout <<endl<< " =================== Removing tips ===================" << endl;
+        getLog() <<endl<< " =================== Removing tips ===================" << endl;
 
 #ifdef DEBUG
         size_t tp=0, tn=0, fp=0,fn=0;
@@ -35,14 +60,75 @@ bool DBGraph::clipTips(int round)
 #endif
 
         size_t numDeleted = 0, numTotal = 0;
-        cout << "Cut-off value for removing tips is: " << redLineValueCov << endl;
+        getLog() << "Cut-off value for removing tips is: " << redLineValueCov << endl;
         double threshold = redLineValueCov;
 
-        for (NodeID id = 1; id <= numNodes; id++) {
+        vector<vector<NodeID> > threadCandidates;
+        const size_t numThreads = numWorkerThreads;
+        if (deadEndsKnown) {
+                // A) a node can only become a dead end when its arcs change,
+                // so only the previous dead ends and the changed nodes qualify
+                vector<NodeID> changedNodes;
+                getChangedNodes(tipCursor, changedNodes);
+                threadCandidates.resize(1);
+                set_union(deadEnds.begin(), deadEnds.end(),
+                          changedNodes.begin(), changedNodes.end(),
+                          back_inserter(threadCandidates[0]));
+                // the statistics count the valid nodes as they change
+                updateStatistics();
+                numTotal = stats.getNumNodes();
+        } else {
+                // A) find the dead ends in parallel, each thread handles a range of nodes
+                threadCandidates.resize(numThreads);
+                vector<size_t> threadNumValid(numThreads, 0);
+                vector<thread> workerThreads(numThreads);
+                for (size_t i = 0; i < workerThreads.size(); i++)
+                        workerThreads[i] = thread(&DBGraph::findTipCandidatesThread, this,
+                                                  i, numThreads, &threadCandidates[i],
+                                                  &threadNumValid[i]);
+                for_each(workerThreads.begin(), workerThreads.end(), mem_fn(&thread::join));
+
+                for (size_t i = 0; i < numThreads; i++)
+                        numTotal += threadNumValid[i];
+                tipCursor = changeLog.size();
+        }
+
+        // B) visit the candidates in increasing order of identifier, as a
+        // serial scan would. Removing a tip can turn a neighbour into a dead
+        // end, neighbours with a higher identifier are therefore revisited.
+        // The remaining dead ends are kept for the next call.
+        priority_queue<NodeID, vector<NodeID>, greater<NodeID> > revisit;
+        const size_t numLists = threadCandidates.size();
+        size_t thisThread = 0, candIdx = 0;
+        NodeID prevID = 0;
+        deadEnds.clear();
+
+        while (true) {
+                while (thisThread < numLists &&
+                       candIdx == threadCandidates[thisThread].size()) {
+                        thisThread++;
+                        candIdx = 0;
+                }
+
+                NodeID id = 0;
+                if (thisThread < numLists)
+                        id = threadCandidates[thisThread][candIdx];
+                if (!revisit.empty() && (id == 0 || revisit.top() < id)) {
+                        id = revisit.top();
+                        revisit.pop();
+                } else if (id != 0) {
+                        candIdx++;
+                } else {
+                        break;
+                }
+
+                if (id <= prevID)
+                        continue;
+                prevID = id;
+
                 SSNode node = getSSNode(id);
                 if (!node.isValid())
                         continue;
-                numTotal++;
 
                 // check for dead ends
                 bool leftDE = (node.getNumLeftArcs() == 0);
@@ -56,12 +142,24 @@ bool DBGraph::clipTips(int round)
                 if (isolated||joinedTip)
                         threshold=this->safeValueCov;
                 bool remove = false;
+                vector<NodeID> neighbours;
                 if ((startNode.getNodeKmerCov() <threshold) &&
-                    (startNode.getMarginalLength() < maxNodeSizeToDel))
+                    (startNode.getMarginalLength() < maxNodeSizeToDel)) {
+                        for (ArcIt it = startNode.leftBegin(); it != startNode.leftEnd(); it++)
+                                neighbours.push_back(abs(it->getNodeID()));
+                        for (ArcIt it = startNode.rightBegin(); it != startNode.rightEnd(); it++)
+                                neighbours.push_back(abs(it->getNodeID()));
                         remove = removeNode(startNode);
+                }
 
-                if (remove)
+                if (remove) {
                         numDeleted++;
+                        for (size_t i = 0; i < neighbours.size(); i++)
+                                if (neighbours[i] > id)
+                                        revisit.push(neighbours[i]);
+                } else {
+                        deadEnds.push_back(id);
+                }
 
 #ifdef DEBUG
 
@@ -101,7 +199,9 @@ bool DBGraph::clipTips(int round)
 #endif
         }
 
-        cout << "Clipped " << numDeleted << "/" << numTotal << " nodes" << endl;
+        deadEndsKnown = true;
+
+        getLog() << "Clipped " << numDeleted << "/" << numTotal << " nodes" << endl;
 #ifdef DEBUG
         cout << "****************************************" << endl;
         cout << "Isolated TP: " << tps << "\tTN: "<< tns << "\tFP: " << fps << "\tFN: "<< fns << endl;
@@ -0,0 +1,384 @@
+/***************************************************************************
+ *   Copyright (C) 2014, 2015 Jan Fostier (jan.fostier@intec.ugent.be)     *
+ *   Copyright (C) 2014, 2015 Mahdi Heydari (mahdi.heydari@intec.ugent.be) *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "graph.h"
+#include "settings.h"
+
+#include <thread>
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * Find the root of a node in a union-find forest, with path halving
+ * @param parent Union-find forest
+ * @param nodeID Identifier of the node (positive)
+ * @return Identifier of the root
+ */
+static NodeID findRoot(vector<atomic<NodeID> >& parent, NodeID nodeID)
+{
+        while (true) {
+                NodeID p = parent[nodeID].load();
+                if (p == nodeID)
+                        return nodeID;
+                NodeID gp = parent[p].load();
+                parent[nodeID].compare_exchange_weak(p, gp);
+                nodeID = gp;
+        }
+}
+
+/**
+ * Join the trees of two nodes, the root with the largest identifier is
+ * attached to the other root. Safe to call concurrently.
+ * @param parent Union-find forest
+ * @param a Identifier of the first node (positive)
+ * @param b Identifier of the second node (positive)
+ */
+static void unite(vector<atomic<NodeID> >& parent, NodeID a, NodeID b)
+{
+        while (true) {
+                a = findRoot(parent, a);
+                b = findRoot(parent, b);
+                if (a == b)
+                        return;
+                if (a < b)
+                        swap(a, b);
+                NodeID expected = a;
+                if (parent[a].compare_exchange_strong(expected, b))
+                        return;
+        }
+}
+
+/**
+ * Compare two bundles by decreasing size
+ */
+static bool compareBundleSize(const vector<NodeID>& a, const vector<NodeID>& b)
+{
+        if (a.size() != b.size())
+                return a.size() > b.size();
+        return a.front() < b.front();
+}
+
+void DBGraph::findComponentsThread(size_t myID, size_t numThreads,
+                                   vector<atomic<NodeID> >* parent) const
+{
+        activate();
+        NodeID firstID = 1 + (myID * numNodes) / numThreads;
+        NodeID lastID = ((myID + 1) * numNodes) / numThreads;
+
+        for (NodeID id = firstID; id <= lastID; id++) {
+                const DSNode& node = getDSNode(id);
+                if (!node.isValid())
+                        continue;
+                for (ArcIt it = node.leftBegin(); it != node.leftEnd(); it++)
+                        unite(*parent, id, abs(it->getNodeID()));
+                for (ArcIt it = node.rightBegin(); it != node.rightEnd(); it++)
+                        unite(*parent, id, abs(it->getNodeID()));
+        }
+}
+
+void DBGraph::createComponentBundles(vector<vector<NodeID> >& bundles) const
+{
+        // A) label the components in parallel
+        vector<atomic<NodeID> > parent(numNodes + 1);
+        for (NodeID id = 0; id <= numNodes; id++)
+                parent[id].store(id);
+
+        const size_t numThreads = numWorkerThreads;
+        vector<thread> workerThreads(numThreads);
+        for (size_t i = 0; i < workerThreads.size(); i++)
+                workerThreads[i] = thread(&DBGraph::findComponentsThread, this,
+                                          i, numThreads, &parent);
+        for_each(workerThreads.begin(), workerThreads.end(), mem_fn(&thread::join));
+
+        // B) collect the nodes per component, in order of identifier
+        vector<NodeID> compIdx(numNodes + 1, -1);
+        vector<vector<NodeID> > components;
+        size_t numValid = 0;
+        for (NodeID id = 1; id <= numNodes; id++) {
+                if (!getDSNode(id).isValid())
+                        continue;
+                NodeID root = findRoot(parent, id);
+                if (compIdx[root] < 0) {
+                        compIdx[root] = components.size();
+                        components.push_back(vector<NodeID>());
+                }
+                components[compIdx[root]].push_back(id);
+                numValid++;
+        }
+        sort(components.begin(), components.end(), compareBundleSize);
+
+        // C) large components form a bundle of their own, small ones are
+        // grouped until the bundle is large enough
+        size_t targetSize = max<size_t>(1, numValid /
+                (numThreads * COMPONENT_BUNDLES_PER_THREAD));
+        bundles.clear();
+        vector<NodeID> small;
+        for (size_t i = 0; i < components.size(); i++) {
+                if (components[i].size() >= targetSize) {
+                        bundles.push_back(vector<NodeID>());
+                        bundles.back().swap(components[i]);
+                        continue;
+                }
+                small.insert(small.end(), components[i].begin(), components[i].end());
+                if (small.size() >= targetSize) {
+                        bundles.push_back(vector<NodeID>());
+                        bundles.back().swap(small);
+                }
+        }
+        if (!small.empty())
+                bundles.push_back(small);
+        sort(bundles.begin(), bundles.end(), compareBundleSize);
+}
+
+void DBGraph::extractSubgraph(const DBGraph& src, const vector<NodeID>& nodeIDs,
+                              const vector<NodeID>& localID)
+{
+        clear();
+        src.activate();
+
+        numNodes = nodeIDs.size();
+        numArcs = 0;
+        size_t numBytes = 0;
+        for (size_t i = 0; i < nodeIDs.size(); i++) {
+                const DSNode& node = src.getDSNode(nodeIDs[i]);
+                numArcs += node.getNumLeftArcs() + node.getNumRightArcs();
+                numBytes += (node.getLength() + 3) / 4;
+        }
+
+        // A) copy the nodes and arcs, the components are closed
+        nodes = new DSNode[numNodes+1];
+        arcs = new Arc[numArcs+2];
+        ArcID arcOffset = 1;
+        for (NodeID id = 1; id <= numNodes; id++) {
+                const DSNode& node = src.getDSNode(nodeIDs[id-1]);
+                DSNode& newNode = nodes[id];
+                newNode.shareFrom(node);
+
+                newNode.setFirstLeftArcID(arcOffset);
+                for (ArcIt it = node.leftBegin(); it != node.leftEnd(); it++) {
+                        NodeID tID = localID[abs(it->getNodeID())];
+                        arcs[arcOffset].setNodeID((it->getNodeID() > 0) ? tID : -tID);
+                        arcs[arcOffset++].setCoverage(it->getCoverage());
+                }
+
+                newNode.setFirstRightArcID(arcOffset);
+                for (ArcIt it = node.rightBegin(); it != node.rightEnd(); it++) {
+                        NodeID tID = localID[abs(it->getNodeID())];
+                        arcs[arcOffset].setNodeID((it->getNodeID() > 0) ? tID : -tID);
+                        arcs[arcOffset++].setCoverage(it->getCoverage());
+                }
+        }
+
+        // B) modified sequences are stored in our own slabs
+        seqPool.addBorrowedSlab(numBytes, true);
+
+        // C) the coverage parameters of the complete graph are shared
+        readLength = src.readLength;
+        coverage = src.coverage;
+        minCertainVlueCov = src.minCertainVlueCov;
+        minSafeValueCov = src.minSafeValueCov;
+        minRedLineValueCov = src.minRedLineValueCov;
+        estimatedKmerCoverage = src.estimatedKmerCoverage;
+        estimatedMKmerCoverageSTD = src.estimatedMKmerCoverageSTD;
+        certainVlueCov = src.certainVlueCov;
+        safeValueCov = src.safeValueCov;
+        redLineValueCov = src.redLineValueCov;
+        cutOffvalue = src.cutOffvalue;
+        updateCutOffValueRound = src.updateCutOffValueRound;
+        maxNodeSizeToDel = src.maxNodeSizeToDel;
+        readStartCovPerBase = src.readStartCovPerBase;
+        sharedCoverageModel = true;
+
+#ifdef DEBUG
+        // the true multiplicities follow the local numbering
+        if (!src.trueMult.empty()) {
+                trueMult.assign(numNodes + 1, 0);
+                for (NodeID id = 1; id <= numNodes; id++)
+                        trueMult[id] = src.trueMult[nodeIDs[id-1]];
+        }
+#endif
+
+        activate();
+}
+
+void DBGraph::stitchSubgraphs(const vector<DBGraph*>& subgraphs)
+{
+        // A) count the valid nodes and their arcs
+        NodeID newNumNodes = 0;
+        ArcID newNumArcs = 0;
+        for (size_t b = 0; b < subgraphs.size(); b++) {
+                const DBGraph& sub = *subgraphs[b];
+                sub.activate();
+                for (NodeID id = 1; id <= sub.numNodes; id++) {
+                        const DSNode& node = sub.getDSNode(id);
+                        if (!node.isValid())
+                                continue;
+                        newNumNodes++;
+                        newNumArcs += node.getNumLeftArcs() + node.getNumRightArcs();
+                }
+        }
+
+        // B) copy the valid nodes, in order of subgraph
+        DSNode *newNodes = new DSNode[newNumNodes+1];
+        Arc *newArcs = new Arc[newNumArcs+2];
+        vector<pair_k> newExpMult(newNumNodes + 1, make_pair(0, make_pair(0.0, 0.0)));
+#ifdef DEBUG
+        vector<int> newTrueMult(trueMult.empty() ? 0 : newNumNodes + 1, 0);
+#endif
+        NodeID firstID = 0;
+        ArcID arcOffset = 1;
+        for (size_t b = 0; b < subgraphs.size(); b++) {
+                const DBGraph& sub = *subgraphs[b];
+                sub.activate();
+
+                vector<NodeID> newID(sub.numNodes + 1, 0);
+                NodeID numCopied = 0;
+                for (NodeID id = 1; id <= sub.numNodes; id++)
+                        if (sub.getDSNode(id).isValid())
+                                newID[id] = firstID + (++numCopied);
+
+                for (NodeID id = 1; id <= sub.numNodes; id++) {
+                        const DSNode& node = sub.getDSNode(id);
+                        if (!node.isValid())
+                                continue;
+
+                        DSNode& newNode = newNodes[newID[id]];
+                        newNode.shareFrom(node);
+
+                        newNode.setFirstLeftArcID(arcOffset);
+                        for (ArcIt it = node.leftBegin(); it != node.leftEnd(); it++) {
+                                NodeID tID = newID[abs(it->getNodeID())];
+                                newArcs[arcOffset].setNodeID((it->getNodeID() > 0) ? tID : -tID);
+                                newArcs[arcOffset++].setCoverage(it->getCoverage());
+                        }
+
+                        newNode.setFirstRightArcID(arcOffset);
+                        for (ArcIt it = node.rightBegin(); it != node.rightEnd(); it++) {
+                                NodeID tID = newID[abs(it->getNodeID())];
+                                newArcs[arcOffset].setNodeID((it->getNodeID() > 0) ? tID : -tID);
+                                newArcs[arcOffset++].setCoverage(it->getCoverage());
+                        }
+
+                        if (id < (NodeID)sub.nodesExpMult.size())
+                                newExpMult[newID[id]] = sub.nodesExpMult[id];
+#ifdef DEBUG
+                        if (!newTrueMult.empty() && id < (NodeID)sub.trueMult.size())
+                                newTrueMult[newID[id]] = sub.trueMult[id];
+#endif
+                }
+                firstID += numCopied;
+        }
+
+        // C) copy the sequences to a fresh pool, the subgraphs still own
+        // (or share) the old ones
+        SequencePool newPool;
+        for (NodeID id = 1; id <= newNumNodes; id++)
+                newNodes[id].moveSequence(newPool);
+
+        delete [] nodes;
+        delete [] arcs;
+        nodes = newNodes;
+        arcs = newArcs;
+        numNodes = newNumNodes;
+        numArcs = newNumArcs;
+        nodesExpMult.swap(newExpMult);
+#ifdef DEBUG
+        trueMult.swap(newTrueMult);
+#endif
+
+        seqPool.swap(newPool);
+        graphFile.close();
+        workspaces.clear();
+        resetWorklists();
+        statsValid = false;
+
+        activate();
+}
+
+void DBGraph::purifyBundlesThread(const vector<vector<NodeID> >* bundles,
+                                  const vector<NodeID>* localID,
+                                  atomic<size_t>* nextBundle,
+                                  vector<DBGraph*>* subgraphs,
+                                  const LibraryContainer* libraries)
+{
+        // progress messages of the subgraphs are discarded
+        ostream noLog(NULL);
+
+        size_t numValid = 0;
+        for (size_t i = 0; i < bundles->size(); i++)
+                numValid += (*bundles)[i].size();
+
+        while (true) {
+                size_t b = nextBundle->fetch_add(1);
+                if (b >= bundles->size())
+                        break;
+                const vector<NodeID>& bundle = (*bundles)[b];
+
+                DBGraph *sub = new DBGraph(settings);
+                sub->extractSubgraph(*this, bundle, *localID);
+                sub->logStream = &noLog;
+                // a large bundle gets its share of the threads
+                sub->numWorkerThreads = max<size_t>(1,
+                        (numWorkerThreads * bundle.size()) / numValid);
+
+                sub->graphPurification("", *libraries);
+                sub->logStream = &cout;
+                (*subgraphs)[b] = sub;
+        }
+}
+
+void DBGraph::componentPurification(const LibraryContainer& libraries)
+{
+        vector<vector<NodeID> > bundles;
+        createComponentBundles(bundles);
+
+        // position of every node in its bundle, bundles are disjoint
+        vector<NodeID> localID(numNodes + 1, 0);
+        for (size_t b = 0; b < bundles.size(); b++)
+                for (size_t i = 0; i < bundles[b].size(); i++)
+                        localID[bundles[b][i]] = i + 1;
+
+        getLog() << "Purifying " << bundles.size() << " bundles of connected components" << endl;
+
+        // purify the bundles on a pool of threads, larger bundles first
+        atomic<size_t> nextBundle(0);
+        vector<DBGraph*> subgraphs(bundles.size(), NULL);
+        const size_t numThreads = min(numWorkerThreads, bundles.size());
+        vector<thread> workerThreads(numThreads);
+        for (size_t i = 0; i < workerThreads.size(); i++)
+                workerThreads[i] = thread(&DBGraph::purifyBundlesThread, this,
+                                          &bundles, &localID, &nextBundle,
+                                          &subgraphs, &libraries);
+        for_each(workerThreads.begin(), workerThreads.end(), mem_fn(&thread::join));
+
+        // stitch the subgraphs back into one graph
+        NodeID oldNumNodes = getNumValidNodes();
+        stitchSubgraphs(subgraphs);
+        for (size_t b = 0; b < subgraphs.size(); b++)
+                delete subgraphs[b];
+        activate();
+
+        getLog() << "Purified graph from " << oldNumNodes << " to "
+                 << numNodes << " nodes" << endl;
+        updateGraphSize();
+}
@@ -24,6 +24,9 @@
 #include "settings.h"
 #include "library.h"
 #include <cmath>
+#include <set>
+#include <thread>
+#include <functional>
 
 using namespace std;
 
@@ -74,6 +77,8 @@ void DBGraph::parseReads(size_t thisThread,
 
 void DBGraph::workerThread(size_t thisThread, LibraryContainer* inputs)
 {
+        activate();
+
         // local storage of reads
         vector<string> myReadBuf;
 
@@ -117,12 +122,6 @@ void DBGraph::countNodeandArcFrequency(LibraryContainer &inputs)
 //comment by mahdi
 
 
-bool cmssn(const SSNode& first, const SSNode & second ) {
-
-    return first.getMarginalLength()>second.getMarginalLength();
-
-
-}
 /**
  * this routine do the following things
  * 1. calculation of avg and std of node kmer coverage
@@ -134,24 +133,13 @@ bool cmssn(const SSNode& first, const SSNode & second ) {
  */
 
 
-void DBGraph::extractStatistic(int round) {
-        vector <SSNode> nodeArray;
+double DBGraph::estimateCoverageModel(int round) {
         int percentage=5;
         double sumOfReadStcov=0;
-        size_t totalLength=0;
         double StandardErrorMean=0;
         double avg=0;
-        for ( NodeID lID = 1; lID <= numNodes; lID++ ) {
-
-                SSNode node = getSSNode ( lID );
-                if(node.isValid() && node.getMarginalLength()) {
-                        totalLength=totalLength+node.getMarginalLength();
-                        nodeArray.push_back(node);
-
-                }
-
-        }
-        sort(nodeArray.begin(), nodeArray.end(),cmssn );
+        updateStatistics();
+        size_t totalLength=stats.getTotalMarginalLength();
         size_t i=0;
         double sumOfCoverage=0;
         double sumOfMarginalLenght=0;
@@ -162,8 +150,11 @@ void DBGraph::extractStatistic(int round) {
                 sizeLimit=((totalLength*percentage)/100)>settings.getGenomeSize()?settings.getGenomeSize():((totalLength*percentage)/100);
         else
                 sizeLimit= (totalLength*percentage)/100;*/
-        while(sumOfMarginalLenght<sizeLimit) {
-                SSNode tempNode=nodeArray[i];
+        // the longest nodes come straight from the length histogram
+        vector<NodeID> nodeArray;
+        stats.getLongestNodes(sizeLimit, nodeArray);
+        while(i<nodeArray.size()) {
+                SSNode tempNode=getSSNode(nodeArray[i]);
                 sumOfMarginalLenght=sumOfMarginalLenght+tempNode.getMarginalLength();
                 sumOfReadStcov=sumOfReadStcov+tempNode.getReadStartCov();
                 sumOfCoverage=sumOfCoverage+  tempNode.getKmerCov();  //tempNode.getExpMult();
@@ -175,7 +166,7 @@ void DBGraph::extractStatistic(int round) {
         double sumOfSTD=0;
         i=0;
         while(i<num) {
-                SSNode tempNode=nodeArray[i];
+                SSNode tempNode=getSSNode(nodeArray[i]);
                 sumOfSTD=sumOfSTD+((tempNode.getNodeKmerCov())-estimatedKmerCoverage)*((tempNode.getNodeKmerCov())-estimatedKmerCoverage);
                 i++;
         }
@@ -183,8 +174,33 @@ void DBGraph::extractStatistic(int round) {
                 StandardErrorMean=sqrt( sumOfSTD/num);
         if (round==0)
                 estimatedMKmerCoverageSTD=StandardErrorMean;//          sqrt(num)*std;
+        return avg;
+}
 
-        for ( NodeID lID = 1; lID <= numNodes; lID++ ) {
+void DBGraph::extractStatistic(int round) {
+        // a subgraph keeps the coverage model of the complete graph
+        if (!sharedCoverageModel)
+                readStartCovPerBase=estimateCoverageModel(round);
+        double avg=readStartCovPerBase;
+
+        // estimate the multiplicities in parallel, each thread handles a range of nodes
+        if (nodesExpMult.size() < (size_t)numNodes + 1)
+                nodesExpMult.resize(numNodes + 1, make_pair(0, make_pair(0.0, 0.0)));
+        const size_t numThreads = numWorkerThreads;
+        vector<thread> workerThreads(numThreads);
+        for (size_t i = 0; i < workerThreads.size(); i++)
+                workerThreads[i] = thread(&DBGraph::estimateMultiplicityThread, this,
+                                          i, numThreads, avg);
+        for_each(workerThreads.begin(), workerThreads.end(), mem_fn(&thread::join));
+}
+
+void DBGraph::estimateMultiplicityThread(size_t myID, size_t numThreads, double avg)
+{
+        activate();
+        NodeID firstID = 1 + (myID * numNodes) / numThreads;
+        NodeID lastID = ((myID + 1) * numNodes) / numThreads;
+
+        for ( NodeID lID = firstID; lID <= lastID; lID++ ) {
 
                 SSNode node = getSSNode ( lID );
                 if (!node.isValid())
@@ -286,6 +302,8 @@ bool DBGraph::nodeIsBubble(SSNode rootNode, SSNode currNode){
 bool DBGraph::checkNodeIsReliable(SSNode node){
         if (node.getMarginalLength()< Kmer::getK()) // smaller nodes might not be correct, these ndoes can never be deleted
                 return false;
+        if ((size_t)abs(node.getNodeID()) >= nodesExpMult.size())       // no estimate yet
+                return false;
         pair<int, pair<double,double> > result=nodesExpMult[abs( node.getNodeID())];
         double confidenceRatio=result.second.first;
         double inCorrctnessRatio=result.second.second;
@@ -484,6 +502,9 @@ bool DBGraph::mergeSingleNodes(bool force)
                 if (!force&& (left.getNodeKmerCov()<cutOffvalue || right.getNodeKmerCov()<cutOffvalue))
                         continue;
 
+                removeNodeStatistics ( lID );
+                removeNodeStatistics ( rID );
+
                 #ifdef DEBUG
                 if (trueMult.size()>0)
                 if ( ( ( trueMult[abs ( lID )] >= 1 ) && ( trueMult[abs ( rID )] == 0 ) ) ||
@@ -499,6 +520,10 @@ bool DBGraph::mergeSingleNodes(bool force)
                 left.deleteRightArc ( rID );
                 right.deleteLeftArc ( lID );
                 left.inheritRightArcs ( right );
+                logChange ( lID );
+                logChange ( rID );
+                for ( ArcIt it = left.rightBegin(); it != left.rightEnd(); it++ )
+                        logChange ( it->getNodeID() );
                 //left.setExpMult ( left.getExpMult() + right.getExpMult() );
                 left.setKmerCov(left.getKmerCov()+right.getKmerCov());
                 //comment by mahdi
@@ -514,11 +539,12 @@ bool DBGraph::mergeSingleNodes(bool force)
                 convertNodesToString ( deq, str );
 
                 left.setSequence ( str );
+                addNodeStatistics ( lID );
                 lID--;
 
         }
         if (numDeleted>0)
-        cout << "Concatenated " << numDeleted << " nodes" << endl;
+        getLog() << "Concatenated " << numDeleted << " nodes" << endl;
         #ifdef DEBUG
         cout <<numOfIncorrectConnection<< " of connections are between correct and incorrect node"<<endl;
         #endif
@@ -526,6 +552,221 @@ bool DBGraph::mergeSingleNodes(bool force)
 }
 
 
+bool DBGraph::canMergeRight(NodeID nodeID) const
+{
+        SSNode left = getSSNode(nodeID);
+        if (!left.isValid() || left.getNumRightArcs() != 1)
+                return false;
+
+        // don't merge palindromic repeats or self-loops
+        NodeID rID = left.rightBegin()->getNodeID();
+        if (rID == -nodeID || rID == nodeID)
+                return false;
+
+        return getSSNode(rID).getNumLeftArcs() == 1;
+}
+
+void DBGraph::findChainsThread(size_t myID, size_t numThreads,
+                               vector<vector<NodeID> >* chains) const
+{
+        activate();
+        NodeID firstID = 1 + (myID * numNodes) / numThreads;
+        NodeID lastID = ((myID + 1) * numNodes) / numThreads;
+
+        for (NodeID id = firstID; id <= lastID; id++) {
+                for (int strand = 0; strand < 2; strand++) {
+                        NodeID startID = (strand == 0) ? -id : id;
+
+                        // a chain starts at a node that has no left merge
+                        if (!canMergeRight(startID) || canMergeRight(-startID))
+                                continue;
+
+                        vector<NodeID> chain(1, startID);
+                        NodeID currID = startID;
+                        while (canMergeRight(currID)) {
+                                currID = getSSNode(currID).rightBegin()->getNodeID();
+                                chain.push_back(currID);
+                        }
+
+                        // every chain is found from both sides, keep one
+                        if (startID <= -chain.back())
+                                chains->push_back(chain);
+                }
+        }
+}
+
+void DBGraph::mergeChain(const vector<NodeID>& chain,
+                         vector<NodeID>* modifiedNodes)
+{
+        SSNode left = getSSNode(chain.front());
+        for (size_t i = 0; i < chain.size(); i++)
+                removeNodeStatistics(chain[i]);
+
+        // A) update the arcs and the coverage, as for a pairwise merge
+        for (size_t i = 1; i < chain.size(); i++) {
+                SSNode right = getSSNode(chain[i]);
+
+                #ifdef DEBUG
+                if (trueMult.size()>0)
+                if ( ( ( trueMult[abs ( chain.front() )] >= 1 ) && ( trueMult[abs ( chain[i] )] == 0 ) ) ||
+                        ( ( trueMult[abs ( chain[i] )] >= 1 ) && ( trueMult[abs ( chain.front() )] == 0 ) ) ){
+                                trueMult[abs(chain.front())]=0;
+                                trueMult[abs(chain[i])]=0;
+                        }
+                #endif
+
+                left.deleteRightArc(right.getNodeID());
+                right.deleteLeftArc(left.getNodeID());
+                left.inheritRightArcs(right);
+                left.setKmerCov(left.getKmerCov() + right.getKmerCov());
+                left.setReadStartCov(left.getReadStartCov() + right.getReadStartCov());
+                right.invalidate();
+        }
+
+        // the right neighbours of the chain now refer to the first node
+        for (size_t i = 0; i < chain.size(); i++)
+                logChange(chain[i]);
+        for (ArcIt it = left.rightBegin(); it != left.rightEnd(); it++)
+                logChange(it->getNodeID());
+        // the left neighbours keep their arcs, but the coverage of their
+        // child has changed, which can make them bubble roots
+        if (modifiedNodes != NULL) {
+                for (size_t i = 0; i < chain.size(); i++)
+                        modifiedNodes->push_back(abs(chain[i]));
+                for (ArcIt it = left.rightBegin(); it != left.rightEnd(); it++)
+                        modifiedNodes->push_back(abs(it->getNodeID()));
+                for (ArcIt it = left.leftBegin(); it != left.leftEnd(); it++)
+                        modifiedNodes->push_back(abs(it->getNodeID()));
+        }
+
+        // B) build the merged sequence in the orientation of the
+        // double-stranded node, straight from the 2-bit packed sequences
+        const size_t overlap = Kmer::getK() - 1;
+        size_t length = 0;
+        for (size_t i = 0; i < chain.size(); i++)
+                length += getDSNode(abs(chain[i])).getLength();
+        length -= (chain.size() - 1) * overlap;
+
+        size_t numBytes = (length + 3) / 4;
+        uint8_t *buf = seqPool.allocate(numBytes);
+        memset(buf, 0, numBytes);
+
+        bool reversed = (chain.front() < 0);
+        for (size_t i = 0, offset = 0; i < chain.size(); i++) {
+                NodeID id = reversed ? -chain[chain.size() - 1 - i] : chain[i];
+                const TString& seq = getDSNode(abs(id)).getTSequence();
+                size_t skip = (i == 0) ? 0 : overlap;
+                size_t len = seq.getLength() - skip;
+
+                if (id > 0)
+                        TString::copyPacked(seq.getData(), skip, len, false, buf, offset);
+                else
+                        TString::copyPacked(seq.getData(), 0, len, true, buf, offset);
+                offset += len;
+        }
+
+        getDSNode(abs(chain.front())).replaceSequenceSlice(buf, length);
+        addNodeStatistics(chain.front());
+}
+
+void DBGraph::findChainsAround(const vector<NodeID>& nodeIDs,
+                               vector<vector<NodeID> >& chains) const
+{
+        set<NodeID> visited;
+        for (size_t i = 0; i < nodeIDs.size(); i++) {
+                NodeID id = nodeIDs[i];
+                if (!getDSNode(id).isValid() || visited.count(id) > 0)
+                        continue;
+
+                // walk to the start of the chain, a cycle has no start
+                NodeID startID = id;
+                while (canMergeRight(-startID)) {
+                        startID = -getSSNode(-startID).rightBegin()->getNodeID();
+                        if (startID == id)
+                                break;
+                }
+                if (startID == id && canMergeRight(-id))
+                        continue;
+
+                vector<NodeID> chain(1, startID);
+                NodeID currID = startID;
+                visited.insert(abs(startID));
+                while (canMergeRight(currID)) {
+                        currID = getSSNode(currID).rightBegin()->getNodeID();
+                        chain.push_back(currID);
+                        visited.insert(abs(currID));
+                }
+                if (chain.size() == 1)
+                        continue;
+
+                // store the chain as findChainsThread would
+                if (startID > -chain.back()) {
+                        reverse(chain.begin(), chain.end());
+                        for (size_t j = 0; j < chain.size(); j++)
+                                chain[j] = -chain[j];
+                }
+                chains.push_back(chain);
+        }
+}
+
+void DBGraph::getChangedNodes(size_t& cursor, vector<NodeID>& nodeIDs)
+{
+        nodeIDs.clear();
+        for (size_t i = cursor; i < changeLog.size(); i++)
+                if (changeLog[i] != 0)      // removed by compactGraph()
+                        nodeIDs.push_back(changeLog[i]);
+        cursor = changeLog.size();
+
+        sort(nodeIDs.begin(), nodeIDs.end());
+        nodeIDs.erase(unique(nodeIDs.begin(), nodeIDs.end()), nodeIDs.end());
+
+        // drop the changes that have been seen by all passes
+        if ((!chainsMerged || chainCursor == changeLog.size()) &&
+            (!deadEndsKnown || tipCursor == changeLog.size())) {
+                changeLog.clear();
+                chainCursor = tipCursor = 0;
+        }
+}
+
+bool DBGraph::mergeChains(vector<NodeID>* modifiedNodes)
+{
+        const size_t numThreads = numWorkerThreads;
+        vector<vector<vector<NodeID> > > threadChains;
+
+        if (chainsMerged) {
+                // A) all chains have been merged before, a new chain must
+                // contain a node that has changed since
+                vector<NodeID> changedNodes;
+                getChangedNodes(chainCursor, changedNodes);
+                threadChains.resize(1);
+                findChainsAround(changedNodes, threadChains[0]);
+        } else {
+                // A) find the chains in parallel, each thread handles a range of nodes
+                threadChains.resize(numThreads);
+                vector<thread> workerThreads(numThreads);
+                for (size_t i = 0; i < workerThreads.size(); i++)
+                        workerThreads[i] = thread(&DBGraph::findChainsThread, this,
+                                                  i, numThreads, &threadChains[i]);
+                for_each(workerThreads.begin(), workerThreads.end(), mem_fn(&thread::join));
+                chainsMerged = true;
+                chainCursor = changeLog.size();
+        }
+
+        // B) merge the chains, they are disjoint so the order is irrelevant.
+        // The merged nodes are logged after chainCursor and revisited next time.
+        size_t numDeleted = 0;
+        for (size_t i = 0; i < threadChains.size(); i++) {
+                for (size_t j = 0; j < threadChains[i].size(); j++) {
+                        mergeChain(threadChains[i][j], modifiedNodes);
+                        numDeleted += threadChains[i][j].size() - 1;
+                }
+        }
+
+        if (numDeleted > 0)
+                getLog() << "Concatenated " << numDeleted << " nodes" << endl;
+        return (numDeleted > 0);
+}
+
 /**
  * this routine is used to before merging nodes, if two adjacent nodes have a very different coverage
  * they shouldn't be merged together
@@ -707,9 +948,9 @@ double DBGraph::estimateReadStartCoverage ( const ReadLibrary &input,
  */
 bool DBGraph::filterCoverage(float cutOff)
 {
-        cout << endl << " ================== Coverage Filter ==================" << endl;
+        getLog() << endl << " ================== Coverage Filter ==================" << endl;
 
-        cout << "Cut-off value for removing nodes: " << cutOff << endl;
+        getLog() << "Cut-off value for removing nodes: " << cutOff << endl;
         int tp=0;
         int tn=0;
         int fp=0;
@@ -749,7 +990,7 @@ bool DBGraph::filterCoverage(float cutOff)
                         #endif
                 }
         }
-        cout << "Number of nodes deleted based on coverage: " << numFiltered<<endl;
+        getLog() << "Number of nodes deleted based on coverage: " << numFiltered<<endl;
         #ifdef DEBUG
         cout << " Gain value is ("<<100*((double)(tp-fp)/(double)(tp+fn))<< "%)"<<endl;
         cout<< "TP:     "<<tp<<"        TN:     "<<tn<<"        FP:     "<<fp<<"        FN:     "<<fn<<endl;
@@ -784,6 +1025,12 @@ bool DBGraph::removeNode(SSNode & rootNode) {
                 bool result = rrNode.deleteLeftArc ( rootNode.getNodeID() );
                 assert ( result );
         }
+        for ( ArcIt it = rootNode.leftBegin(); it != rootNode.leftEnd(); it++ )
+                logChange ( it->getNodeID() );
+        for ( ArcIt it = rootNode.rightBegin(); it != rootNode.rightEnd(); it++ )
+                logChange ( it->getNodeID() );
+        logChange ( rootNode.getNodeID() );
+        removeNodeStatistics ( rootNode.getNodeID() );
         rootNode.deleteAllRightArcs();
         rootNode.deleteAllLeftArcs();
         rootNode.invalidate();
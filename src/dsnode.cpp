@@ -21,7 +21,8 @@
 
 #include "dsnode.h"
 
-Arc* DSNode::arcs = NULL;
+thread_local Arc* DSNode::arcs = NULL;
+thread_local SequencePool* DSNode::pool = NULL;
 
 bool DSNode::deleteLeftArc(NodeID targetID)
 {
@@ -122,7 +122,9 @@ public:
 class DSNode {
 
 private:
-        static Arc* arcs;
+        // per thread, so that threads can work on different graphs
+        static thread_local Arc* arcs;
+        static thread_local SequencePool* pool;
 
         typedef union {
                 struct Packed {
@@ -153,6 +155,14 @@ public:
                 arcs = arcPtr;
         }
 
+        /**
+         * Set the static sequence pool pointer
+         * @param poolPtr The pool in which node sequences are stored
+         */
+        static void setSequencePool(SequencePool *poolPtr) {
+                pool = poolPtr;
+        }
+
         /**
          * Default constructor
          */
@@ -282,6 +292,22 @@ public:
                         arcs[leftID + i].setNodeID(-arcs[leftID + i].getNodeID());
         }
 
+        /**
+         * Get the raw arc information (number of arcs and flags)
+         * @return The raw arc information
+         */
+        uint8_t getArcInfo() const {
+                return arcInfo.up;
+        }
+
+        /**
+         * Set the raw arc information (number of arcs and flags)
+         * @param target The raw arc information
+         */
+        void setArcInfo(uint8_t target) {
+                arcInfo.up = target;
+        }
+
         /**
          * Get the identifier for the first left arc
          * @return The identifier for the first left arc
@@ -318,6 +344,8 @@ public:
          * Invalidate a node (= mark as deleted)
          */
         void invalidate() {
+                if (isValid() && sequence.isPooled())
+                        pool->release((sequence.getLength() + 3) / 4);
                 arcInfo.p.invalid = 1;
         }
 
@@ -490,7 +518,59 @@ public:
          * @param str String containing only 'A', 'C', 'G' and 'T'
          */
         void setSequence(const std::string& str) {
-                sequence.setSequence(str);
+                if (pool != NULL)
+                        sequence.setSequence(str, *pool);
+                else
+                        sequence.setSequence(str);
+        }
+
+        /**
+         * Let the sequence of this node refer to 2-bit packed pool memory
+         * @param slice Pointer to the 2-bit packed sequence
+         * @param length Number of nucleotides
+         */
+        void setSequenceSlice(uint8_t *slice, uint32_t length) {
+                sequence.setPooledSlice(slice, length);
+        }
+
+        /**
+         * Replace the sequence of this node by a slice of pool memory, the
+         * old sequence is released to the pool
+         * @param slice Pointer to the 2-bit packed sequence
+         * @param length Number of nucleotides
+         */
+        void replaceSequenceSlice(uint8_t *slice, uint32_t length) {
+                if (sequence.isPooled())
+                        pool->release((sequence.getLength() + 3) / 4);
+                sequence.setPooledSlice(slice, length);
+        }
+
+        /**
+         * Copy the contents of another node, the sequence itself is not
+         * copied but shared with the other node
+         * @param rhs Node to copy
+         */
+        void shareFrom(const DSNode& rhs) {
+                sequence.setPooledSlice(const_cast<uint8_t*>(rhs.sequence.getData()),
+                                        rhs.sequence.getLength());
+                leftID = rhs.leftID;
+                rightID = rhs.rightID;
+                arcInfo = rhs.arcInfo;
+                expMult = rhs.expMult;
+                readStartCov = rhs.getReadStartCov();
+                kmerCov = rhs.getKmerCov();
+        }
+
+        /**
+         * Copy the sequence of this node to a fresh sequence pool, the
+         * sequence of an invalid node is discarded
+         * @param newPool Destination sequence pool
+         */
+        void moveSequence(SequencePool& newPool) {
+                if (isValid())
+                        sequence.moveToPool(newPool);
+                else
+                        sequence.clear();
         }
 
         /**
@@ -511,6 +591,16 @@ public:
                 return sequence.substr(offset, len);
         }
 
+        /**
+         * Copy a subsequence of this node to a character buffer
+         * @param offset Start offset
+         * @param len Number of nucleotides to copy
+         * @param dst Destination buffer of at least len characters
+         */
+        void copySubstr(size_t offset, size_t len, char *dst) const {
+                sequence.copySubstr(offset, len, dst);
+        }
+
         /**
          * Get a nucleotide at a specified position ('-' for out-of bounds)
          * @param pos Position in the sequence
@@ -578,43 +668,6 @@ public:
         Kmer getRightKmer() const {
                 return Kmer(sequence, sequence.getLength() - Kmer::getK());
         }
-
-        /**
-         * Write a node to file
-         * @param ofs Open output file stream
-         */
-        void write(std::ofstream& ofs) const {
-                double kmerCov = getKmerCov();
-                Coverage readStCov = getReadStartCov();
-
-                ofs.write((char*)&kmerCov, sizeof(kmerCov));
-                ofs.write((char*)&readStCov, sizeof(readStCov));
-                ofs.write((char*)&leftID, sizeof(leftID));
-                ofs.write((char*)&rightID, sizeof(rightID));
-                ofs.write((char*)&arcInfo, sizeof(arcInfo));
-
-                sequence.write(ofs);
-        }
-
-        /**
-         * Load a node from file
-         * @param ifs Open input file stream
-         */
-        void read(std::ifstream& ifs) {
-                double kmerCov;
-                Coverage readStCov;
-
-                ifs.read((char*)&kmerCov, sizeof(kmerCov));
-                ifs.read((char*)&readStCov, sizeof(readStCov));
-                ifs.read((char*)&leftID, sizeof(leftID));
-                ifs.read((char*)&rightID, sizeof(rightID));
-                ifs.read((char*)&arcInfo, sizeof(arcInfo));
-
-                setKmerCov(kmerCov);
-                setReadStartCov(readStCov);
-
-                sequence.read(ifs);
-        }
 };
 
 #endif
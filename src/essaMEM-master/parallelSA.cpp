@@ -0,0 +1,266 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <limits.h>
+
+#include "parallelSA.hpp"
+
+using namespace std;
+
+// Minimum number of suffixes per work item. Larger groups are sorted by all
+// threads together.
+static const long MIN_CHUNK_SIZE = 1 << 16;
+
+// Suffixes p[start..end] that share their first h symbols.
+struct group_t {
+        group_t() {}
+        group_t(long s, long e) { start = s; end = e; }
+        long start, end;
+};
+
+// The part [from, to) of the groups [first, last): either a batch of small
+// groups or a part of a large group.
+struct range_t {
+        range_t(long fg, long lg, long f, long t) { first = fg; last = lg; from = f; to = t; }
+        long first, last, from, to;
+};
+
+// Sort key type: the key in the high half and the suffix in the low half.
+template<typename T> struct psort_key;
+template<> struct psort_key<int> {
+        typedef uint64_t type;
+        typedef uint32_t index_type;
+        static const int bits = 32;
+};
+template<> struct psort_key<long> {
+        __extension__ typedef unsigned __int128 type; // GCC/Clang extension
+        typedef uint64_t index_type;
+        static const int bits = 64;
+};
+
+// State shared by the threads of one sort.
+template<typename T>
+struct psort_t {
+        typedef typename psort_key<T>::type key_t;
+        typedef typename psort_key<T>::index_type index_t;
+        static const int key_bits = psort_key<T>::bits;
+
+        T *x; // Group numbers, ultimately the inverse suffix array.
+        T *p; // Suffix array.
+        key_t *key; // Sort key (high half) and suffix (low half).
+        long n; // Length of the text.
+        long h; // Length of the already sorted prefixes.
+        int bits; // Number of bits per symbol.
+        long q; // Number of symbols in the initial sort key.
+        int num_threads;
+        long chunk; // Larger groups are sorted by all threads.
+
+        vector<group_t> groups; // Unsorted groups of the current round.
+        vector<range_t> ranges; // Work items of the current round.
+        vector<vector<group_t> > next; // Unsorted groups found by each thread.
+
+        group_t big; // Large group that is sorted by all threads.
+        long chunkLen; // Size of the parts of the large group.
+        long width; // Size of the sorted runs to merge.
+
+        atomic<long> next_item; // Next unprocessed work item.
+};
+
+template<typename T>
+struct psort_thread_t {
+        psort_t<T> *ps;
+        int id;
+};
+
+template<typename T>
+static inline long sortKey(typename psort_t<T>::key_t k) { return (long)(k >> psort_t<T>::key_bits); }
+template<typename T>
+static inline T suffix(typename psort_t<T>::key_t k) { return (T)(typename psort_t<T>::index_t)k; }
+static inline long groupSize(const group_t &g) { return g.end - g.start + 1; }
+
+// Runs a function on all threads and waits for them to finish.
+template<typename T>
+static void runThreads(psort_t<T> &ps, void *(*fn)(void *)) {
+        vector<pthread_t> thread_ids(ps.num_threads);
+        vector<psort_thread_t<T> > data(ps.num_threads);
+
+        pthread_attr_t attr; pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+        ps.next_item = 0;
+        for (int i = 0; i < ps.num_threads; i++) { data[i].ps = &ps; data[i].id = i; }
+        for (int i = 0; i < ps.num_threads; i++) pthread_create(&thread_ids[i], &attr, fn, (void *)&data[i]);
+        for (int i = 0; i < ps.num_threads; i++) pthread_join(thread_ids[i], NULL);
+
+        pthread_attr_destroy(&attr);
+}
+
+// Pairs each suffix with the group number of the suffix h positions further.
+// In the first round (h = 0), suffix j is paired with its first q symbols.
+template<typename T>
+static void *packThread(void *arg) {
+        psort_t<T> &ps = *((psort_thread_t<T>*)arg)->ps;
+        typedef typename psort_t<T>::key_t key_t;
+        typedef typename psort_t<T>::index_t index_t;
+        for (long w = ps.next_item++; w < (long)ps.ranges.size(); w = ps.next_item++) {
+                const range_t &r = ps.ranges[w];
+                for (long g = r.first; g < r.last; g++) {
+                        long to = min(r.to, ps.groups[g].end + 1);
+                        for (long j = max(r.from, ps.groups[g].start); j < to; j++) {
+                                if (ps.h == 0) {
+                                        key_t prefix = 0;
+                                        for (long c = 0; c < ps.q; c++)
+                                                prefix = (prefix << ps.bits) | (key_t)(j + c < ps.n ? ps.x[j + c] : 0);
+                                        ps.key[j] = (prefix << psort_t<T>::key_bits) | (index_t)j;
+                                } else {
+                                        T s = ps.p[j];
+                                        ps.key[j] = ((key_t)ps.x[s + ps.h] << psort_t<T>::key_bits) | (index_t)s;
+                                }
+                        }
+                }
+        }
+        return 0;
+}
+
+// Sorts the small groups.
+template<typename T>
+static void *sortSmallThread(void *arg) {
+        psort_t<T> &ps = *((psort_thread_t<T>*)arg)->ps;
+        for (long w = ps.next_item++; w < (long)ps.ranges.size(); w = ps.next_item++) {
+                const range_t &r = ps.ranges[w];
+                for (long g = r.first; g < r.last; g++)
+                        if (groupSize(ps.groups[g]) <= ps.chunk)
+                                sort(ps.key + ps.groups[g].start, ps.key + ps.groups[g].end + 1);
+        }
+        return 0;
+}
+
+// Sorts one part of the large group.
+template<typename T>
+static void *sortChunkThread(void *arg) {
+        psort_thread_t<T> *data = (psort_thread_t<T>*)arg;
+        psort_t<T> &ps = *data->ps;
+        long len = ps.big.end - ps.big.start + 1;
+        long first = min(len, data->id * ps.chunkLen);
+        long last = min(len, first + ps.chunkLen);
+        sort(ps.key + ps.big.start + first, ps.key + ps.big.start + last);
+        return 0;
+}
+
+// Merges pairs of adjacent sorted runs of the large group.
+template<typename T>
+static void *mergeThread(void *arg) {
+        psort_t<T> &ps = *((psort_thread_t<T>*)arg)->ps;
+        long len = ps.big.end - ps.big.start + 1;
+        typename psort_t<T>::key_t *base = ps.key + ps.big.start;
+        for (long w = ps.next_item++; w * 2 * ps.width < len; w = ps.next_item++) {
+                long first = w * 2 * ps.width;
+                long middle = min(len, first + ps.width);
+                long last = min(len, first + 2 * ps.width);
+                inplace_merge(base + first, base + middle, base + last);
+        }
+        return 0;
+}
+
+// Stores the sorted suffixes and assigns new group numbers. A run of equal
+// keys is handled by the thread whose range contains its first element.
+template<typename T>
+static void *rankThread(void *arg) {
+        psort_thread_t<T> *data = (psort_thread_t<T>*)arg;
+        psort_t<T> &ps = *data->ps;
+        vector<group_t> &next = ps.next[data->id];
+        for (long w = ps.next_item++; w < (long)ps.ranges.size(); w = ps.next_item++) {
+                const range_t &r = ps.ranges[w];
+                for (long g = r.first; g < r.last; g++) {
+                        long start = ps.groups[g].start, end = ps.groups[g].end;
+                        long from = max(r.from, start), to = min(r.to, end + 1);
+                        for (long j = from; j < to; j++)
+                                ps.p[j] = suffix<T>(ps.key[j]);
+
+                        long j = from;
+                        while (j > start && j < to && sortKey<T>(ps.key[j]) == sortKey<T>(ps.key[j-1])) j++;
+                        while (j < to) {
+                                long b = j;
+                                while (b < end && sortKey<T>(ps.key[b+1]) == sortKey<T>(ps.key[j])) b++;
+                                for (long m = j; m <= b; m++) ps.x[suffix<T>(ps.key[m])] = b;
+                                if (b > j) next.push_back(group_t(j, b));
+                                j = b + 1;
+                        }
+                }
+        }
+        return 0;
+}
+
+// Sorts a group that is too large for a single thread.
+template<typename T>
+static void sortBigGroup(psort_t<T> &ps, const group_t &g) {
+        long len = g.end - g.start + 1;
+        ps.big = g;
+        ps.chunkLen = (len + ps.num_threads - 1) / ps.num_threads;
+        runThreads(ps, sortChunkThread<T>);
+        for (ps.width = ps.chunkLen; ps.width < len; ps.width *= 2)
+                runThreads(ps, mergeThread<T>);
+}
+
+template<typename T>
+void parallelSuffixSort(T *x, T *p, long n, long k, int num_threads) {
+        psort_t<T> ps;
+        ps.x = x; ps.p = p;
+        ps.key = new typename psort_t<T>::key_t[n + 1];
+        ps.n = n;
+        ps.num_threads = num_threads;
+        ps.next.resize(num_threads);
+        ps.chunk = max(MIN_CHUNK_SIZE, n / (8 * num_threads));
+
+        // The first round sorts all suffixes on as many symbols as fit in
+        // the sort key (the end-of-string symbol and beyond are 0).
+        ps.bits = 1;
+        while ((1L << ps.bits) < k) ps.bits++;
+        ps.q = max(1, psort_t<T>::key_bits / ps.bits);
+        ps.groups.push_back(group_t(0, n));
+
+        // The group number of a suffix is the highest position of its group.
+        // A suffix whose first h symbols include the end-of-string symbol is
+        // in a group of its own, so s + h <= n holds for every unsorted suffix.
+        for (ps.h = 0; !ps.groups.empty(); ps.h = (ps.h == 0) ? ps.q : 2 * ps.h) {
+                // Batch small groups, split large groups into parts.
+                ps.ranges.clear();
+                vector<group_t> big;
+                long first = 0, batchSize = 0;
+                for (long g = 0; g < (long)ps.groups.size(); g++) {
+                        long size = groupSize(ps.groups[g]);
+                        if (size <= ps.chunk) {
+                                batchSize += size;
+                                if (batchSize < ps.chunk) continue;
+                                ps.ranges.push_back(range_t(first, g + 1, 0, LONG_MAX));
+                        } else {
+                                if (first < g) ps.ranges.push_back(range_t(first, g, 0, LONG_MAX));
+                                for (long f = ps.groups[g].start; f <= ps.groups[g].end; f += ps.chunk)
+                                        ps.ranges.push_back(range_t(g, g + 1, f, f + ps.chunk));
+                                big.push_back(ps.groups[g]);
+                        }
+                        first = g + 1;
+                        batchSize = 0;
+                }
+                if (first < (long)ps.groups.size())
+                        ps.ranges.push_back(range_t(first, ps.groups.size(), 0, LONG_MAX));
+
+                runThreads(ps, packThread<T>);
+                runThreads(ps, sortSmallThread<T>);
+                for (size_t i = 0; i < big.size(); i++) sortBigGroup(ps, big[i]);
+                runThreads(ps, rankThread<T>);
+
+                ps.groups.clear();
+                for (int t = 0; t < num_threads; t++) {
+                        ps.groups.insert(ps.groups.end(), ps.next[t].begin(), ps.next[t].end());
+                        ps.next[t].clear();
+                }
+        }
+
+        delete[] ps.key;
+}
+
+template void parallelSuffixSort<int>(int *x, int *p, long n, long k, int num_threads);
+template void parallelSuffixSort<long>(long *x, long *p, long n, long k, int num_threads);
@@ -0,0 +1,17 @@
+#ifndef __parallelSA_hpp__
+#define __parallelSA_hpp__
+
+// Suffix sorting by prefix doubling with multiple threads. Only the groups of
+// suffixes that are not yet sorted are refined in each round (as in the
+// Larsson-Sadakane algorithm). Small groups are spread over the threads,
+// large groups are sorted by all threads together.
+//
+// Same contract as suffixsort() in qsufsort.c: x[0..n-1] holds the text
+// with symbols in [1, k) and x[n] is regarded as a unique end-of-string
+// symbol, smaller than all others. On return, p[0..n] holds the suffix array
+// (p[0] = n) and x[0..n] holds its inverse. T is int or long (for texts of
+// INT_MAX symbols or more).
+template<typename T>
+void parallelSuffixSort(T *x, T *p, long n, long k, int num_threads);
+
+#endif // __parallelSA_hpp__
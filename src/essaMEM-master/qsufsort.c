@@ -13,7 +13,17 @@
 
 #include <limits.h>
 
-static int *I,                  /* group array, ultimately suffix array.*/
+/* Altered for brownie: the integer type and the name of the entry point are
+   parameters, so that a file that includes this one can build a variant with
+   64-bit integers (see qsufsort64.c). The defaults are the original ones.*/
+
+#ifndef QSUF_INT
+#define QSUF_INT int
+#define QSUF_INT_MAX INT_MAX
+#define QSUF_SUFFIXSORT suffixsort
+#endif
+
+static QSUF_INT *I,             /* group array, ultimately suffix array.*/
    *V,                          /* inverse array, ultimately inverse of I.*/
    r,                           /* number of symbols aggregated by transform.*/
    h;                           /* length of already-sorted prefixes.*/
@@ -27,9 +37,9 @@ static int *I,                  /* group array, ultimately suffix array.*/
 /* Subroutine for select_sort_split and sort_split. Sets group numbers for a
    group whose lowest position in I is pl and highest position is pm.*/
 
-static void update_group(int *pl, int *pm)
+static void update_group(QSUF_INT *pl, QSUF_INT *pm)
 {
-   int g;
+   QSUF_INT g;
 
    g=pm-I;                      /* group number.*/
    V[*pl]=g;                    /* update group number of first position.*/
@@ -44,9 +54,9 @@ static void update_group(int *pl, int *pm)
 /* Quadratic sorting method to use for small subarrays. To be able to update
    group numbers consistently, a variant of selection sorting is used.*/
 
-static void select_sort_split(int *p, int n) {
-   int *pa, *pb, *pi, *pn;
-   int f, v, tmp;
+static void select_sort_split(QSUF_INT *p, QSUF_INT n) {
+   QSUF_INT *pa, *pb, *pi, *pn;
+   QSUF_INT f, v, tmp;
 
    pa=p;                        /* pa is start of group being picked out.*/
    pn=p+n-1;                    /* pn is last position of subarray.*/
@@ -71,9 +81,9 @@ static void select_sort_split(int *p, int n) {
 
 /* Subroutine for sort_split, algorithm by Bentley & McIlroy.*/
 
-static int choose_pivot(int *p, int n) {
-   int *pl, *pm, *pn;
-   int s;
+static QSUF_INT choose_pivot(QSUF_INT *p, QSUF_INT n) {
+   QSUF_INT *pl, *pm, *pn;
+   QSUF_INT s;
    
    pm=p+(n>>1);                 /* small arrays, middle element.*/
    if (n>7) {
@@ -96,10 +106,10 @@ static int choose_pivot(int *p, int n) {
    Software -- Practice and Experience 23(11), 1249-1265 (November 1993). This
    function is based on Program 7.*/
 
-static void sort_split(int *p, int n)
+static void sort_split(QSUF_INT *p, QSUF_INT n)
 {
-   int *pa, *pb, *pc, *pd, *pl, *pm, *pn;
-   int f, v, s, t, tmp;
+   QSUF_INT *pa, *pb, *pc, *pd, *pl, *pm, *pn;
+   QSUF_INT f, v, s, t, tmp;
 
    if (n<7) {                   /* multi-selection sort smallest arrays.*/
       select_sort_split(p, n);
@@ -158,9 +168,9 @@ static void sort_split(int *p, int n)
    Output: x is V and p is I after the initial sorting stage of the refined
    suffix sorting algorithm.*/
       
-static void bucketsort(int *x, int *p, int n, int k)
+static void bucketsort(QSUF_INT *x, QSUF_INT *p, QSUF_INT n, QSUF_INT k)
 {
-   int *pi, i, c, d, g;
+   QSUF_INT *pi, i, c, d, g;
 
    for (pi=p; pi<p+k; ++pi)
       *pi=-1;                   /* mark linked lists empty.*/
@@ -193,25 +203,25 @@ static void bucketsort(int *x, int *p, int n, int k)
    storage. q controls aggregation and compaction by defining the maximum value
    for any symbol during transformation: q must be at least k-l; if q<=n,
    compaction is guaranteed; if k-l>n, compaction is never done; if q is
-   INT_MAX, the maximum number of symbols are aggregated into one.
+   QSUF_INT_MAX, the maximum number of symbols are aggregated into one.
    
    Output: Returns an integer j in the range 1...q representing the size of the
    new alphabet. If j<=n+1, the alphabet is compacted. The global variable r is
    set to the number of old symbols grouped into one. Only x[n] is 0.*/
 
-static int transform(int *x, int *p, int n, int k, int l, int q)
+static QSUF_INT transform(QSUF_INT *x, QSUF_INT *p, QSUF_INT n, QSUF_INT k, QSUF_INT l, QSUF_INT q)
 {
-   int b, c, d, e, i, j, m, s;
-   int *pi, *pj;
+   QSUF_INT b, c, d, e, i, j, m, s;
+   QSUF_INT *pi, *pj;
    
    for (s=0, i=k-l; i; i>>=1)
       ++s;                      /* s is number of bits in old symbol.*/
-   e=INT_MAX>>s;                /* e is for overflow checking.*/
+   e=QSUF_INT_MAX>>s;           /* e is for overflow checking.*/
    for (b=d=r=0; r<n && d<=e && (c=d<<s|(k-l))<=q; ++r) {
       b=b<<s|(x[r]-l+1);        /* b is start of x in chunk alphabet.*/
       d=c;                      /* d is max symbol in chunk alphabet.*/
    }
-   m=(1<<(r-1)*s)-1;            /* m masks off top old symbol from chunk.*/
+   m=((QSUF_INT)1<<(r-1)*s)-1;  /* m masks off top old symbol from chunk.*/
    x[n]=l-1;                    /* emulate zero terminator.*/
    if (d<=n) {                  /* if bucketing possible, compact alphabet.*/
       for (pi=p; pi<=p+d; ++pi)
@@ -255,10 +265,10 @@ static int transform(int *x, int *p, int n, int k, int l, int q)
    contents of x[n] is disregarded, the n-th symbol being regarded as
    end-of-string smaller than all other symbols.*/
 
-void suffixsort(int *x, int *p, int n, int k, int l)
+void QSUF_SUFFIXSORT(QSUF_INT *x, QSUF_INT *p, QSUF_INT n, QSUF_INT k, QSUF_INT l)
 {
-   int *pi, *pk;
-   int i, j, s, sl;
+   QSUF_INT *pi, *pk;
+   QSUF_INT i, j, s, sl;
    
    V=x;                         /* set global values.*/
    I=p;
@@ -267,7 +277,7 @@ void suffixsort(int *x, int *p, int n, int k, int l)
       j=transform(V, I, n, k, l, n);
       bucketsort(V, I, n, j);   /* bucketsort on first r positions.*/
    } else {
-      transform(V, I, n, k, l, INT_MAX);
+      transform(V, I, n, k, l, QSUF_INT_MAX);
       for (i=0; i<=n; ++i)
          I[i]=i;                /* initialize I with suffix numbers.*/
       h=0;
@@ -0,0 +1,12 @@
+/* qsufsort64.c
+   Added for brownie: qsufsort.c with 64-bit integers, for texts of INT_MAX
+   symbols or more. Like the original, it sorts in place: apart from the
+   text and the suffix array it needs no memory.*/
+
+#include <limits.h>
+
+#define QSUF_INT long
+#define QSUF_INT_MAX LONG_MAX
+#define QSUF_SUFFIXSORT suffixsort64
+
+#include "qsufsort.c"
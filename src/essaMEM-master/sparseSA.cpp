@@ -8,15 +8,17 @@
 #include <fstream>
 
 #include "sparseSA.hpp"
+#include "parallelSA.hpp"
 
 // LS suffix sorter (integer alphabet).
 extern "C" { void suffixsort(int *x, int *p, int n, int k, int l); }
+extern "C" { void suffixsort64(long *x, long *p, long n, long k, long l); }
 
 pthread_mutex_t cout_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 long memCount = 0;
 
-sparseSA::sparseSA(string &S_, vector<string> const &descr_,
+sparseSA::sparseSA(packed_text &S_, vector<string> const &descr_,
         vector<long> &startpos_, bool __4column, long K_,
         bool suflink_, bool child_, bool kmer_,
         int sparseMult_, int kMerSize_, bool printSubstring_,
@@ -45,14 +47,11 @@ sparseSA::sparseSA(string &S_, vector<string> const &descr_,
 
         // Increase string length so divisible by K.
         // Don't forget to count $ termination character.
-        if (S.length() % K != 0) {
-                long appendK = K - S.length() % K ;
-                for (long i = 0; i < appendK; i++) S += '$';
-        }
+        if (S.length() % K != 0) S.pad(K - S.length() % K);
         // Make sure last K-sampled characeter is this special character as well!!
-        for (long i = 0; i < K; i++) S += '$'; // Append "special" end character. Note: It must be lexicographically less.
+        S.pad(K); // Append "special" end character. Note: It must be lexicographically less.
 
-        std::string(S.data(), S.size()).swap(S);
+        S.compact();
 
         N = S.length();
 
@@ -78,26 +77,80 @@ void sparseSA::computeLCP() {
         }
 }
 
+// Kasai et al for the sampled suffixes [first, last). The LCP values
+// >= 255 are collected in M instead of LCP.M.
+void sparseSA::computeLCP(long first, long last, vector<vec_uchar::item_t> &M) {
+        long h=0;
+        for (long i = first*K; i < last*K; i+=K) {
+                long m = ISA[i/K];
+                if (m==0) h = 0;
+                else {
+                        long j = SA[m-1];
+                        while (i+h < N && j+h < N && S[i+h] == S[j+h])        h++;
+                }
+                if (h >= numeric_limits<unsigned char>::max()) {
+                        LCP.vec[m] = numeric_limits<unsigned char>::max();
+                        M.push_back(vec_uchar::item_t(m, h));
+                }
+                else LCP.vec[m] = (unsigned char)h;
+                h = max(0L, h - K);
+        }
+}
+
+struct lcp_thread_data {
+        sparseSA *sa; // Suffix array + aux informaton
+        long first, last; // Range of sampled suffixes.
+        vector<vec_uchar::item_t> M; // Large LCP values.
+};
+
+void *LCPthread(void *arg) {
+        lcp_thread_data *data = (lcp_thread_data*)arg;
+        data->sa->computeLCP(data->first, data->last, data->M);
+        pthread_exit(NULL);
+        return 0;
+}
+
+// Kasai et al with every thread handling a range of sampled suffixes.
+void sparseSA::computeLCP(int num_threads) {
+        if (num_threads <= 1) { computeLCP(); return; }
+
+        vector<pthread_t> thread_ids(num_threads);
+        vector<lcp_thread_data> data(num_threads);
+
+        pthread_attr_t attr; pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+        for (int i = 0; i < num_threads; i++) {
+                data[i].sa = this;
+                data[i].first = (N/K * i) / num_threads;
+                data[i].last = (N/K * (i+1)) / num_threads;
+        }
+        for (int i = 0; i < num_threads; i++) pthread_create(&thread_ids[i], &attr, LCPthread, (void *)&data[i]);
+        for (int i = 0; i < num_threads; i++) pthread_join(thread_ids[i], NULL);
+
+        for (int i = 0; i < num_threads; i++) LCP.M.insert(LCP.M.end(), data[i].M.begin(), data[i].M.end());
+}
+
 // Child array construction algorithm
 void sparseSA::computeChild() {
-        for (int i = 0; i < N/K; i++) {
-                CHILD[i] = -1;
+        for (long i = 0; i < N/K; i++) {
+                CHILD.set(i, -1);
         }
         //Compute up and down values
-        int lastIndex = -1;
-        stack<int,vector<int> > stapelUD;
+        long lastIndex = -1;
+        stack<long,vector<long> > stapelUD;
         stapelUD.push(0);
-        for (int i = 1; i < N/K; i++) {
+        for (long i = 1; i < N/K; i++) {
                 while (LCP[i] < LCP[stapelUD.top()]) {
                         lastIndex = stapelUD.top();
                         stapelUD.pop();
                         if (LCP[i] <= LCP[stapelUD.top()] && LCP[stapelUD.top()] != LCP[lastIndex]) {
-                        CHILD[stapelUD.top()] = lastIndex;
+                        CHILD.set(stapelUD.top(), lastIndex);
                         }
                 }
                 //now LCP[i] >= LCP[top] holds
                 if (lastIndex != -1) {
-                        CHILD[i-1] = lastIndex;
+                        CHILD.set(i-1, lastIndex);
                         lastIndex = -1;
                 }
                 stapelUD.push(i);
@@ -106,19 +159,19 @@ void sparseSA::computeChild() {
                 lastIndex = stapelUD.top();
                 stapelUD.pop();
                 if (0 <= LCP[stapelUD.top()] && LCP[stapelUD.top()] != LCP[lastIndex]) {
-                        CHILD[stapelUD.top()] = lastIndex;
+                        CHILD.set(stapelUD.top(), lastIndex);
                 }
         }
         //Compute Next L-index values
-        stack<int,vector<int> > stapelNL;
+        stack<long,vector<long> > stapelNL;
         stapelNL.push(0);
-        for (int i = 1; i < N/K; i++) {
+        for (long i = 1; i < N/K; i++) {
                 while (LCP[i] < LCP[stapelNL.top()])
                 stapelNL.pop();
                 lastIndex = stapelNL.top();
                 if (LCP[i] == LCP[lastIndex]) {
                         stapelNL.pop();
-                        CHILD[lastIndex] = i;
+                        CHILD.set(lastIndex, i);
                 }
                 stapelNL.push(i);
         }
@@ -219,7 +272,26 @@ void sparseSA::computeKmer() {
 }
 
 //TODO: add error handling and messages
-void sparseSA::save(const string &prefix) {
+// Writes an index vector: its width, its size and the raw values.
+static void write_index(ofstream &os, const vec_index &v) {
+        long size = v.size();
+        os.write((const char*)&v.width,sizeof(v.width));
+        os.write((const char*)&size,sizeof(size));
+        os.write((const char*)&v.vec[0],v.vec.size());
+}
+
+static bool read_index(ifstream &is, vec_index &v) {
+        int width; long size;
+        is.read((char*)&width,sizeof(width));
+        is.read((char*)&size,sizeof(size));
+        if (!is || (width != 4 && width != 5 && width != 8) || size < 0) return false;
+        v.width = width;
+        v.resize(size);
+        is.read((char*)&v.vec[0],v.vec.size());
+        return (bool)is;
+}
+
+bool sparseSA::save(const string &prefix) {
         string basic = prefix;
         string aux = basic + ".aux";
         string sa = basic + ".sa";
@@ -235,38 +307,37 @@ void sparseSA::save(const string &prefix) {
         aux_s.write((const char*)&hasKmer,sizeof(hasKmer));
         aux_s.write((const char*)&kMerSize,sizeof(kMerSize));
         aux_s.close();
+        if (!aux_s) return false;
         //print sa
         ofstream sa_s (sa.c_str(), ios::binary);
-        unsigned int sizeSA = SA.size();
-        sa_s.write((const char*)&sizeSA,sizeof(sizeSA));
-        sa_s.write((const char*)&SA[0],sizeSA*sizeof(unsigned int));
+        write_index(sa_s, SA);
         sa_s.close();
+        if (!sa_s) return false;
         //print LCP
         ofstream lcp_s (lcp.c_str(), ios::binary);
-        unsigned int sizeLCP = LCP.vec.size();
-        unsigned int sizeM = LCP.M.size();
+        long sizeLCP = LCP.vec.size();
+        long sizeM = LCP.M.size();
         lcp_s.write((const char*)&sizeLCP,sizeof(sizeLCP));
         lcp_s.write((const char*)&sizeM,sizeof(sizeM));
         lcp_s.write((const char*)&LCP.vec[0],sizeLCP*sizeof(unsigned char));
         lcp_s.write((const char*)&LCP.M[0],sizeM*sizeof(vec_uchar::item_t));
         lcp_s.close();
+        if (!lcp_s) return false;
         //print ISA if nec
         if (hasSufLink) {
                 string isa = basic + ".isa";
                 ofstream isa_s (isa.c_str(), ios::binary);
-                unsigned int sizeISA = ISA.size();
-                isa_s.write((const char*)&sizeISA,sizeof(sizeISA));
-                isa_s.write((const char*)&ISA[0],sizeISA*sizeof(int));
+                write_index(isa_s, ISA);
                 isa_s.close();
+                if (!isa_s) return false;
         }
         //print child if nec
         if (hasChild) {
                 string child = basic + ".child";
                 ofstream child_s (child.c_str(), ios::binary);
-                unsigned int sizeCHILD = CHILD.size();
-                child_s.write((const char*)&sizeCHILD,sizeof(sizeCHILD));
-                child_s.write((const char*)&CHILD[0],sizeCHILD*sizeof(int));
+                write_index(child_s, CHILD);
                 child_s.close();
+                if (!child_s) return false;
         }
         //print kmer if nec
         if (hasKmer) {
@@ -276,7 +347,9 @@ void sparseSA::save(const string &prefix) {
                 kmer_s.write((const char*)&sizeKMR,sizeof(sizeKMR));
                 kmer_s.write((const char*)&KMR[0],sizeKMR*sizeof(saTuple_t));
                 kmer_s.close();
+                if (!kmer_s) return false;
         }
+        return true;
 }
 
 bool sparseSA::load(const string &prefix) {
@@ -290,77 +363,109 @@ bool sparseSA::load(const string &prefix) {
                 cout << "unable to open " << prefix << endl;
                 return false;
         }
+        // everything is read into temporaries first: the index is only
+        // replaced once all files are complete, a failed load leaves it
+        // ready for construct()
         //read auxiliary information
-        long readN;
-        aux_s.read((char*)&readN,sizeof(N));
-        N = readN;
-        aux_s.read((char*)&K,sizeof(K));
-        aux_s.read((char*)&logN,sizeof(logN));
-        aux_s.read((char*)&NKm1,sizeof(NKm1));
-        aux_s.read((char*)&hasSufLink,sizeof(hasSufLink));
-        aux_s.read((char*)&hasChild,sizeof(hasChild));
-        aux_s.read((char*)&hasKmer,sizeof(hasKmer));
-        aux_s.read((char*)&kMerSize,sizeof(kMerSize));
+        long readN, readK, readLogN, readNKm1, readKMerSize;
+        bool readSufLink, readChild, readKmer;
+        aux_s.read((char*)&readN,sizeof(readN));
+        aux_s.read((char*)&readK,sizeof(readK));
+        aux_s.read((char*)&readLogN,sizeof(readLogN));
+        aux_s.read((char*)&readNKm1,sizeof(readNKm1));
+        aux_s.read((char*)&readSufLink,sizeof(readSufLink));
+        aux_s.read((char*)&readChild,sizeof(readChild));
+        aux_s.read((char*)&readKmer,sizeof(readKmer));
+        aux_s.read((char*)&readKMerSize,sizeof(readKMerSize));
+        if (!aux_s) return false;
         aux_s.close();
+        // the index must belong to the text of this object
+        if (readN != N || readK != K) return false;
         //read sa
+        vec_index readSA;
         ifstream sa_s (sa.c_str(), ios::binary);
-        unsigned int sizeSA;
-        sa_s.read((char*)&sizeSA,sizeof(sizeSA));
-        SA.resize(sizeSA);
-        sa_s.read((char*)&SA[0],sizeSA*sizeof(unsigned int));
+        if (!read_index(sa_s, readSA)) return false;
+        if ((long)readSA.size() != readN / readK) return false;
         sa_s.close();
         //read LCP
+        vec_uchar readLCP;
         ifstream lcp_s (lcp.c_str(), ios::binary);
-        unsigned int sizeLCP;
-        unsigned int sizeM;
+        long sizeLCP;
+        long sizeM;
         lcp_s.read((char*)&sizeLCP,sizeof(sizeLCP));
         lcp_s.read((char*)&sizeM,sizeof(sizeM));
-        LCP.vec.resize(sizeLCP);
-        LCP.M.resize(sizeM);
-        lcp_s.read((char*)&LCP.vec[0],sizeLCP*sizeof(unsigned char));
-        lcp_s.read((char*)&LCP.M[0],sizeM*sizeof(vec_uchar::item_t));
+        if (!lcp_s || sizeLCP < 0 || sizeM < 0) return false;
+        readLCP.vec.resize(sizeLCP);
+        readLCP.M.resize(sizeM);
+        lcp_s.read((char*)&readLCP.vec[0],sizeLCP*sizeof(unsigned char));
+        lcp_s.read((char*)&readLCP.M[0],sizeM*sizeof(vec_uchar::item_t));
+        if (!lcp_s) return false;
         lcp_s.close();
         //read ISA if nec
-        if (hasSufLink) {
+        vec_index readISA;
+        if (readSufLink) {
                 string isa = basic + ".isa";
                 ifstream isa_s (isa.c_str(), ios::binary);
-                unsigned int sizeISA;
-                isa_s.read((char*)&sizeISA,sizeof(sizeISA));
-                ISA.resize(sizeISA);
-                isa_s.read((char*)&ISA[0],sizeISA*sizeof(int));
+                if (!read_index(isa_s, readISA)) return false;
                 isa_s.close();
         }
         //read child if nec
-        if (hasChild) {
+        vec_index readCHILD;
+        if (readChild) {
                 string child = basic + ".child";
                 ifstream child_s (child.c_str(), ios::binary);
-                unsigned int sizeCHILD;
-                child_s.read((char*)&sizeCHILD,sizeof(sizeCHILD));
-                CHILD.resize(sizeCHILD);
-                child_s.read((char*)&CHILD[0],sizeCHILD*sizeof(int));
+                if (!read_index(child_s, readCHILD)) return false;
                 child_s.close();
         }
         //read kmer table if nec
-        if (hasKmer) {
+        vector<saTuple_t> readKMR;
+        if (readKmer) {
                 string kmer = basic + ".kmer";
                 ifstream kmer_s (kmer.c_str(), ios::binary);
                 unsigned int sizeKMR;
-                kmer_s.read((char*)&sizeKMR,sizeof(sizeKMR));
-                KMR.resize(sizeKMR);
-                kMerTableSize = sizeKMR;
-                kmer_s.read((char*)&KMR[0],sizeKMR*sizeof(saTuple_t));
+                if (!kmer_s.read((char*)&sizeKMR,sizeof(sizeKMR))) return false;
+                readKMR.resize(sizeKMR);
+                kmer_s.read((char*)&readKMR[0],sizeKMR*sizeof(saTuple_t));
+                if (!kmer_s) return false;
                 kmer_s.close();
         }
+        //all files are complete, replace the index
+        logN = readLogN;
+        NKm1 = readNKm1;
+        hasSufLink = readSufLink;
+        hasChild = readChild;
+        hasKmer = readKmer;
+        kMerSize = readKMerSize;
+        swap(SA, readSA);
+        swap(LCP, readLCP);
+        swap(ISA, readISA);
+        swap(CHILD, readCHILD);
+        KMR.swap(readKMR);
+        if (hasKmer) kMerTableSize = KMR.size();
         cout << "index loaded succesful" << endl;
         return true;
 }
 
-void sparseSA::construct() {
+// Overloads of the integer suffix sorters: qsufsort with a single thread,
+// the parallel sorter otherwise. qsufsort sorts in place, the parallel
+// sorter adds a sort key of twice the integer size per suffix.
+static void suffixsort(int *x, int *p, long n, long k, int l, int num_threads) {
+        if (num_threads > 1) parallelSuffixSort(x, p, n, k, num_threads);
+        else suffixsort(x, p, n, k, l);
+}
+
+static void suffixsort(long *x, long *p, long n, long k, int l, int num_threads) {
+        if (num_threads > 1) parallelSuffixSort(x, p, n, k, num_threads);
+        else suffixsort64(x, p, n, k, l);
+}
+
+template<typename T>
+void sparseSA::sortSuffixes(int num_threads) {
         if (K > 1) {
                 long bucketNr = 1;
-                int *intSA = new int[N/K+1];
-                for (int i = 0; i < N/K; i++) intSA[i] = i; // Init SA.
-                int* t_new = new int[N/K+1];
+                T *intSA = new T[N/K+1];
+                for (long i = 0; i < N/K; i++) intSA[i] = i; // Init SA.
+                T* t_new = new T[N/K+1];
                 long* BucketBegin = new long[256]; // array to save current bucket beginnings
                 radixStep(t_new, intSA, bucketNr, BucketBegin, 0, N/K-1, 0); // start radix sort
                 t_new[N/K] = 0; // Terminate new integer string.
@@ -368,23 +473,29 @@ void sparseSA::construct() {
 
                 // Suffix sort integer text.
                 //cout << "# suffixsort()" << endl;
-                suffixsort(t_new, intSA, N/K, bucketNr, 0);
+                suffixsort(t_new, intSA, N/K, bucketNr, 0, num_threads);
                 //cout << "# DONE suffixsort()" << endl;
 
                 delete[] t_new;
 
                 // Translate suffix array.
                 SA.resize(N/K);
-                for (long i=0; i<N/K; i++) SA[i] = (unsigned int)intSA[i+1] * K;
+                for (long i=0; i<N/K; i++) SA.set(i, (long)intSA[i+1] * K);
                 delete[] intSA;
 
                 // Build ISA using sparse SA.
                 ISA.resize(N/K);
-                for (long i = 0; i < N/K; i++) { ISA[SA[i]/K] = i; }
+                for (long i = 0; i < N/K; i++) { ISA.set(SA[i]/K, i); }
         }
         else {
-                SA.resize(N);
-                ISA.resize(N);
+                // Sort in place if the index width matches T.
+                bool inPlace = (SA.width == sizeof(T)) && (ISA.width == sizeof(T));
+                if (inPlace) {
+                        SA.resize(N);
+                        ISA.resize(N);
+                }
+                T *SAint = inPlace ? (T*)SA.data() : new T[N];
+                T *ISAint = inPlace ? (T*)ISA.data() : new T[N];
                 int char2int[UCHAR_MAX+1]; // Map from char to integer alphabet.
 
                 // Zero char2int mapping.
@@ -401,27 +512,45 @@ void sparseSA::construct() {
                 }
 
                 // Remap the alphabet.
-                for (long i = 0; i < N; i++) ISA[i] = (int)S[i];
-                for (long i = 0; i < N; i++) ISA[i]=char2int[ISA[i]] + 1;
+                for (long i = 0; i < N; i++) ISAint[i] = (int)S[i];
+                for (long i = 0; i < N; i++) ISAint[i]=char2int[ISAint[i]] + 1;
                 // First "character" equals 1 because of above plus one, l=1 in suffixsort().
                 int alphalast = alphasz + 1;
 
                 // Use LS algorithm to construct the suffix array.
-                int *SAint = (int*)(&SA[0]);
-                suffixsort(&ISA[0], SAint , N-1, alphalast, 1);
+                suffixsort(ISAint, SAint, N-1, alphalast, 1, num_threads);
+
+                // Narrow the indices one array at a time. SA follows from
+                // ISA, so at most the two T arrays are allocated at once.
+                if (!inPlace) {
+                        delete[] SAint;
+                        ISA.resize(N);
+                        for (long i = 0; i < N; i++) ISA.set(i, ISAint[i]);
+                        delete[] ISAint;
+                        SA.resize(N);
+                        for (long i = 0; i < N; i++) SA.set(ISA[i], i);
+                }
         }
+}
+
+void sparseSA::construct(int num_threads) {
+        // The index width depends on the largest value that is stored.
+        SA.set_width(vec_index::width_for(N));
+        ISA.set_width(vec_index::width_for(N/K));
+        CHILD.set_width(vec_index::width_for(N/K));
+
+        if (N/K < INT_MAX) sortSuffixes<int>(num_threads);
+        else sortSuffixes<long>(num_threads);
 
         //cout << "N=" << N << endl;
 
         LCP.resize(N/K);
         //cout << "N/K=" << N/K << endl;
         // Use algorithm by Kasai et al to construct LCP array.
-        computeLCP(); // SA + ISA -> LCP
+        computeLCP(num_threads); // SA + ISA -> LCP
         LCP.init();
         if (!hasSufLink) {
-                vector<int> tmp;
-                ISA.swap(tmp);
-        //ISA.clear();
+                ISA.clear();
         }
         if (hasChild) {
                 CHILD.resize(N/K);
@@ -443,7 +572,8 @@ void sparseSA::construct() {
 // Recurse until big-K size prefixes are sorted. Adapted from the C++
 // source code for the wordSA implementation from the following paper:
 // Ferragina and Fischer. Suffix Arrays on Words. CPM 2007.
-void sparseSA::radixStep(int *t_new, int *SA, long &bucketNr, long *BucketBegin, long l, long r, long h) {
+template<typename T>
+void sparseSA::radixStep(T *t_new, T *SA, long &bucketNr, long *BucketBegin, long l, long r, long h) {
         if (h >= K) return;
         // first pass: count
         vector<long> Sigma(256, 0); // Sigma counts occurring characters in bucket
@@ -463,7 +593,7 @@ void sparseSA::radixStep(int *t_new, int *SA, long &bucketNr, long *BucketBegin,
                 else {
                         // American flag sort of McIlroy et al. 1993. BucketBegin keeps
                         // track of current position where to add to bucket set.
-                        int tmp = SA[ BucketBegin[ S[ SA[pos]*K + h ] ] ];
+                        T tmp = SA[ BucketBegin[ S[ SA[pos]*K + h ] ] ];
                         SA[ BucketBegin[ S[ SA[pos]*K + h] ]++ ] = SA[pos];        // Move bucket beginning to the right, and replace
                         SA[ pos ] = tmp; // Save value at bucket beginning.
                         if (S[ SA[pos]*K + h ] == currentKey) pos++; // Advance to next position if the right character.
@@ -632,7 +762,7 @@ void sparseSA::traverse_faster(const string &P,const long prefix, interval_t &cu
 }
 
 //finds the first l index of the lcp interval
-int sparseSA::get_first_l(int const start, int const end) const {
+long sparseSA::get_first_l(long const start, long const end) const {
         /*
          *        if cur.end = N / K - 1 and CHILD[N / K - 1]] = -1, then
          *        CHILD[end] < start and the condition is false
@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <limits>
 #include <limits.h>
+#include <string.h>
+#include <stdint.h>
 
 
 using namespace std;
@@ -82,6 +84,103 @@ struct vec_uchar {
         }
 };
 
+// Stores suffix array indices in 4, 5 or 8 bytes, depending on the largest
+// value that must be stored. Values are signed and stored little-endian.
+// Simulates a vector<long>.
+struct vec_index {
+        vector<unsigned char> vec; // Values, width bytes each.
+        int width; // Bytes per value.
+        size_t N; // Number of values.
+        vec_index() : width(4), N(0) {}
+        // Smallest width that can hold the values 0..maxVal (and -1).
+        static int width_for(long maxVal) {
+                if (maxVal <= INT_MAX) return 4;
+                if (maxVal < (1L << 39)) return 5;
+                return 8;
+        }
+        void set_width(int w) { width = w; resize(N); }
+        // Eight bytes of padding allow any value to be read as 8 bytes.
+        void resize(size_t N_) { N = N_; vec.resize(N * width + 8); }
+        size_t size() const { return N; }
+        void clear() { vector<unsigned char>().swap(vec); N = 0; }
+        // Raw storage, usable as an int or long array if width matches.
+        void *data() { return &vec[0]; }
+        long operator[] (size_t idx) const {
+                if (width == 4) { int v; memcpy(&v, &vec[idx*4], 4); return v; }
+                if (width == 8) { long v; memcpy(&v, &vec[idx*8], 8); return v; }
+                long v; memcpy(&v, &vec[idx*5], 8);
+                return (v << 24) >> 24; // Sign extend 40 bits.
+        }
+        void set(size_t idx, long v) { memcpy(&vec[idx*width], &v, width); }
+        bool operator== (const vec_index &o) const { return width == o.width && N == o.N && vec == o.vec; }
+
+        long index_size_in_bytes() const {
+                return sizeof(vec) + vec.capacity()*sizeof(unsigned char);
+        }
+};
+
+// Text made of records seq + '>' + reverse complement of seq + '>',
+// followed by '$' padding. Only the forward strands are stored, 2 bits
+// per base; separators follow from the record boundaries and the reverse
+// strands are generated on the fly. Symbols other than ACGT are stored as T.
+// Simulates a (read-only) string.
+struct packed_text {
+        static const int BLOCK_BITS = 6; // Positions per block: 64.
+        vector<uint64_t> bases; // Forward strands, 32 bases per word.
+        vector<long> recStart; // Start of each record, then the end of the last.
+        vector<int> blockRec; // Record holding the first position of each block.
+        long numBases; // Number of stored bases.
+        long padLen; // Number of '$' characters after the last record.
+        packed_text() : recStart(1, 0), numBases(0), padLen(0) {}
+
+        // Appends the record for seq. All records precede the padding.
+        void append(const string &seq) {
+                for (size_t j = 0; j < seq.size(); j++, numBases++) {
+                        if ((numBases & 31) == 0) bases.push_back(0);
+                        uint64_t code = BITADD[(unsigned char)seq[j]] & 3;
+                        bases.back() |= code << (2 * (numBases & 31));
+                }
+                long end = recStart.back() + 2 * (long)seq.size() + 2;
+                while (((long)blockRec.size() << BLOCK_BITS) < end)
+                        blockRec.push_back(recStart.size() - 1);
+                recStart.push_back(end);
+        }
+        void pad(long n) { padLen += n; }
+        long length() const { return recStart.back() + padLen; }
+        long size() const { return length(); }
+        // Releases the excess capacity once the text is complete.
+        void compact() {
+                vector<uint64_t>(bases).swap(bases);
+                vector<long>(recStart).swap(recStart);
+                vector<int>(blockRec).swap(blockRec);
+        }
+        int base(long j) const { return (bases[j >> 5] >> (2 * (j & 31))) & 3; }
+        char operator[] (long i) const {
+                long end = recStart.back();
+                if (i >= end) return (i < end + padLen) ? '$' : '\0';
+                long r = blockRec[i >> BLOCK_BITS];
+                while (recStart[r+1] <= i) r++;
+                long start = recStart[r], len = (recStart[r+1] - start) / 2 - 1;
+                long rel = i - start, first = start / 2 - r; // first base of the record
+                if (rel < len) return "ACGT"[base(first + rel)];
+                if (rel == len || rel == 2 * len + 1) return '>';
+                return "TGCA"[base(first + 2 * len - rel)];
+        }
+        string substr(long pos, long len) const {
+                string s;
+                for (long i = pos; i < min(pos + len, length()); i++) s += (*this)[i];
+                return s;
+        }
+
+        long index_size_in_bytes() const {
+                long indexSize = sizeof(*this);
+                indexSize += bases.capacity()*sizeof(uint64_t);
+                indexSize += recStart.capacity()*sizeof(long);
+                indexSize += blockRec.capacity()*sizeof(int);
+                return indexSize;
+        }
+};
+
 // Match find by findMEM.
 struct match_t {
         match_t() { ref = 0; query = 0, len = 0; }
@@ -93,9 +192,9 @@ struct match_t {
 
 struct saTuple_t {
         saTuple_t(): left(0), right(0) {}
-        saTuple_t(unsigned int l, unsigned int r): left(l), right(r){}
-        unsigned int left;
-        unsigned int right;
+        saTuple_t(long l, long r): left(l), right(r){}
+        long left;
+        long right;
 };
 
 // depth : [start...end]
@@ -116,11 +215,11 @@ struct sparseSA {
         long N; //!< Length of the sequence.
         long logN; // ceil(log(N))
         long NKm1; // N/K - 1
-        string &S; //!< Reference to sequence data.
-        vector<unsigned int> SA; // Suffix array.
-        vector<int> ISA; // Inverse suffix array.
+        packed_text &S; //!< Reference to sequence data.
+        vec_index SA; // Suffix array.
+        vec_index ISA; // Inverse suffix array.
         vec_uchar LCP; // Simulates a vector<int> LCP.
-        vector<int> CHILD; //child table
+        vec_index CHILD; //child table
         vector<saTuple_t> KMR;
 
         long K; // suffix sampling, K = 1 every suffix, K = 2 every other suffix, K = 3, every 3rd sffix
@@ -159,11 +258,11 @@ struct sparseSA {
                         indexSize += descr[i].capacity();
                 }
                 indexSize += sizeof(startpos) + startpos.capacity()*sizeof(long);
-                indexSize += S.capacity();
-                indexSize += sizeof(SA) + SA.capacity()*sizeof(unsigned int);
-                indexSize += sizeof(ISA) + ISA.capacity()*sizeof(int);
-                indexSize += sizeof(CHILD) + CHILD.capacity()*sizeof(int);
-                indexSize += sizeof(KMR) + KMR.capacity()*(2*sizeof(unsigned int));
+                indexSize += S.index_size_in_bytes();
+                indexSize += SA.index_size_in_bytes();
+                indexSize += ISA.index_size_in_bytes();
+                indexSize += CHILD.index_size_in_bytes();
+                indexSize += sizeof(KMR) + KMR.capacity()*sizeof(saTuple_t);
                 indexSize += LCP.index_size_in_bytes();
                 return indexSize;
         }
@@ -179,19 +278,24 @@ struct sparseSA {
         }
 
         // Constructor builds sparse suffix array.
-        sparseSA(string &S_, vector<string> const &descr_, vector<long> &startpos_,
+        sparseSA(packed_text &S_, vector<string> const &descr_, vector<long> &startpos_,
         bool __4column, long K_, bool suflink_, bool child_, bool kmer_, int sparseMult_,
         int kMerSize_, bool printSubstring_, bool printRevCompForw_, bool nucleotidesOnly_);
 
         // Modified Kasai et all for LCP computation.
         void computeLCP();
+        void computeLCP(int num_threads); // multithreaded version
+        void computeLCP(long first, long last, vector<vec_uchar::item_t> &M); // range of sampled suffixes
         //Modified Abouelhoda et all for CHILD Computation.
         void computeChild();
         //build look-up table for sa intervals of kmers up to some depth
         void computeKmer();
 
+        // Suffix sorting with int (N/K < INT_MAX) or long indices.
+        template<typename T> void sortSuffixes(int num_threads);
+
         // Radix sort required to construct transformed text for sparse SA construction.
-        void radixStep(int *t_new, int *SA, long &bucketNr, long *BucketBegin, long l, long r, long h);
+        template<typename T> void radixStep(T *t_new, T *SA, long &bucketNr, long *BucketBegin, long l, long r, long h);
 
         // Prints match to cout.
         void print_match(match_t m) const;
@@ -202,7 +306,7 @@ struct sparseSA {
         void checkMatches(std::string const &P, std::vector<match_t> const &matches, int const min_len) const;
 
         //find the first l index of an lcp-interval
-        int get_first_l(int const start, int const end) const;
+        long get_first_l(long const start, long const end) const;
 
         // Binary search for left boundry of interval.
         inline long bsearch_left(char c, long i, long s, long e) const;
@@ -276,14 +380,14 @@ struct sparseSA {
         // Maximal Unique Match (MUM)
         void MUM(string const &P, vector<match_t> &unique, int min_len, long& memCount, bool forward_, bool print);
 
-        //save index to files
-        void save(const string &prefix);
+        //save index to files, returns false on a write error
+        bool save(const string &prefix);
 
-        //load index from file
+        //load index from file, the index is unchanged if this fails
         bool load(const string &prefix);
 
         //construct
-        void construct();
+        void construct(int num_threads = 1);
 };
 
 
@@ -72,6 +72,32 @@ typedef uint32_t KmerLSB;       // set to uint16_t and all hell will break loose
 // result in more parallel chunks at the cost of increased memory use.
 #define NUM_RECORD_BLOCKS 2
 
+// Size (in bytes) of a slab in the node sequence pool and the fraction of
+// dead bytes in the pool that triggers a compaction of the node sequences
+#define SEQUENCE_SLAB_SIZE 16777216
+#define SEQUENCE_COMPACT_RATIO 0.5
+
+// The graph is renumbered when the fraction of valid nodes drops below this
+#define GRAPH_COMPACT_LIVE_FRACTION 0.5
+
+// Width of a bin in the histogram of the node k-mer coverage
+#define COVERAGE_BIN_WIDTH 0.1
+
+// Values of log(k!) that are tabulated for the Poisson distribution
+#define LOG_FACTORIAL_TABLE_SIZE 65536
+
+// Number of bundles of connected components per thread (component mode)
+#define COMPONENT_BUNDLES_PER_THREAD 8
+
+// Format version of the cached essaMEM index (stage 5)
+#define ESSAMEM_CACHE_VERSION 2
+
+// Number of candidate sequences aligned together, one per 16-bit SIMD lane
+#define ALIGNMENT_BATCH_SIZE 8
+
+// Bits per kmer in the kmer filter of the graph (stage 5)
+#define KMER_FILTER_BITS_PER_KMER 12
+
 // ============================================================================
 // TYPEDEFS
 // ============================================================================
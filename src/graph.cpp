@@ -26,16 +26,28 @@
 #include "kmernode.h"
 #include "library.h"
 #include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+#include <sstream>
 
 using namespace std;
 
-DSNode* SSNode::nodes = NULL;
-const DBGraph* DBGraph::graph = NULL;
+thread_local DSNode* SSNode::nodes = NULL;
+thread_local const DBGraph* DBGraph::graph = NULL;
 
 
 DBGraph::DBGraph(const Settings& settings) : table(NULL), settings(settings),
         nodes(NULL), arcs(NULL), numNodes(0), numArcs(0), mapType(SHORT_MAP) {
     DBGraph::graph = this;
+    resetWorklists();
+    statsValid = false;
+    numWorkerThreads = settings.getNumThreads();
+    logStream = &cout;
+    checkpointSource = 0;
+    checkpointMode = CHECKPOINT_MODE_GRAPH;
+    readStartCovPerBase = 0;
+    sharedCoverageModel = false;
     //mahdi comment my
     initialize();
 }
@@ -75,9 +87,10 @@ void DBGraph::initialize()
  *
  */
 void DBGraph::graphPurification(string trueMultFilename,
-                                const LibraryContainer& libraries)
+                                const LibraryContainer& libraries,
+                                int firstRound)
 {
-        int round=1;
+        int round=firstRound;
         updateGraphSize();
         size_t maxBubbleDepth=maxNodeSizeToDel;
         size_t increamentDepth = readLength;
@@ -88,7 +101,7 @@ void DBGraph::graphPurification(string trueMultFilename,
                 updateCutOffValue(round);
                 bool tips=clipTips(round);
                 if(tips) {
-                        mergeSingleNodes(true);
+                        mergeChains();
                         #ifdef DEBUG
                         compareToSolution(trueMultFilename, false);
                         #endif
@@ -100,34 +113,29 @@ void DBGraph::graphPurification(string trueMultFilename,
                 updateCutOffValue(round);
                 compareToSolution(trueMultFilename, false);
                 #endif
-                cout << endl << " ================= Bubble Detection ==================" << endl;
-                bubble= bubbleDetection(depth);
-                mergeSingleNodes(true);
-                bool continuEdit=true;
+                getLog() << endl << " ================= Bubble Detection ==================" << endl;
                 size_t maxDepth=(round)*increamentDepth>maxBubbleDepth?maxBubbleDepth:(round)*increamentDepth;
-                while(depth<maxDepth&& continuEdit){
+                vector<size_t> depths(1, depth);
+                while(depth<maxDepth){
                         depth=depth+increamentDepth;
-                        cout << "Bubble depth: " << depth << endl;
-                        continuEdit= bubbleDetection(depth);
-                        if (continuEdit)
-                                mergeSingleNodes(true);
-                        bubble=false?continuEdit:bubble;
+                        depths.push_back(depth);
                 }
+                bubble= bubbleDetection(depths);
                 #ifdef DEBUG
                 compareToSolution(trueMultFilename,false);
                 updateCutOffValue(round);
                 #endif
                 extractStatistic(round);
-                cout << endl << " ============= Delete Unreliable Nodes  ==============" << endl;
+                getLog() << endl << " ============= Delete Unreliable Nodes  ==============" << endl;
                 bool deleted=deleteUnreliableNodes();
-                mergeSingleNodes(true);
-                continuEdit=deleted;
+                mergeChains();
+                bool continuEdit=deleted;
                 while(continuEdit){
                         continuEdit=deleteUnreliableNodes();
-                        mergeSingleNodes(true);
+                        mergeChains();
                         extractStatistic(round);
                 }
-                while(mergeSingleNodes(true));
+                mergeChains();
                 #ifdef DEBUG
                 compareToSolution(trueMultFilename,false);
                 updateCutOffValue(round);
@@ -136,6 +144,13 @@ void DBGraph::graphPurification(string trueMultFilename,
                 #endif
                 simplified = tips    || deleted || bubble;
                 updateGraphSize();
+                if (getNumValidNodes() < GRAPH_COMPACT_LIVE_FRACTION * numNodes)
+                        compactGraph();
+                else if (seqPool.needsCompaction())
+                        compactSequences();
+                // the final round is repeated rather than checkpointed
+                if (simplified)
+                        writeCheckpoint(round);
                 round++;
         }
 }
@@ -152,64 +167,35 @@ void DBGraph::graphPurification(string trueMultFilename,
 void DBGraph::updateCutOffValue(int round)
 {
         #ifdef DEBUG
-        //this part are going to make plot
-        if (updateCutOffValueRound==1){
-
-                string command="rm "+settings.getTempDirectory() + "cov/*";
-                cout<<command<<endl;
-                system(command.c_str());
-                command = "mkdir " + settings.getTempDirectory() + "cov";
-                system(command.c_str());
-                cout<<command<<endl;
-        }
-        char roundStr[15];
-        sprintf(roundStr, "%d", round);
-        string strRound =string (roundStr);
-        vector<pair<double,pair<size_t , pair<bool, int> > > > allNodes;
-        vector<pair< pair< int , int> , pair<double,int> > > frequencyArray;
-        size_t validNodes=0;
-        for (NodeID i =1; i <= numNodes; i++) {
-                SSNode n = getSSNode(i);
-                if(!n.isValid())
-                        continue;
-                validNodes++;
-                double kmerCoverage=n.getNodeKmerCov();
-                int marginalLength=n.getMarginalLength();//+ settings.getK();
-                bool correctNode=false;
-                double nodeMultiplicityR=1;
-                #ifdef DEBUG
-                nodeMultiplicityR=trueMult[abs(n.getNodeID())];
-                if (nodeMultiplicityR>0)
-                        correctNode=true;
-                #endif
-
-                allNodes.push_back( make_pair(kmerCoverage, make_pair( nodeMultiplicityR, make_pair(correctNode,marginalLength)) ));
-        }
-        std::sort (allNodes.begin(), allNodes.end());
-        unsigned int i=0;
-        double Interval=.1;
-        double  St=allNodes[0].first;
-        //frequencyArray.push_back(make_pair(make_pair(settings.getKmerCovOne(), 0) , make_pair(1,settings.getKmerCovOne())));
-        while (i<allNodes.size()-1) {
-                double intervalCount=0;
-                int sumOfMarginalLenght=0;
-                int correctNodeMarginalLength=0;
-                while (allNodes[i].first>=St && allNodes[i].first<St+Interval&& i<allNodes.size()-1) {
-                        intervalCount++;
-                        i++;
-                        sumOfMarginalLenght=sumOfMarginalLenght+allNodes[i].second.second.second ;
-                        if (allNodes[i].second.second.first)
-                                correctNodeMarginalLength=correctNodeMarginalLength+allNodes[i].second.second.second;
+        // the subgraphs of the component purification are purified
+        // concurrently, they would overwrite each other's plots
+        if (!sharedCoverageModel) {
+                //this part are going to make plot
+                if (updateCutOffValueRound==1){
+
+                        string command="rm "+settings.getTempDirectory() + "cov/*";
+                        cout<<command<<endl;
+                        system(command.c_str());
+                        command = "mkdir " + settings.getTempDirectory() + "cov";
+                        system(command.c_str());
+                        cout<<command<<endl;
                 }
-                double representative=St+Interval/2;
-                if (intervalCount!=0)
-                        frequencyArray.push_back(make_pair(make_pair( sumOfMarginalLenght, correctNodeMarginalLength) , make_pair(representative,intervalCount)));
-                St=St+Interval;
-                if (St>estimatedKmerCoverage+estimatedMKmerCoverageSTD*3)
-                        break;
+                updateStatistics();
+                vector<pair< pair< int , int> , pair<double,int> > > frequencyArray;
+                const map<size_t, GraphStatistics::CoverageBin>& covHist = stats.getCoverageHistogram();
+                for (map<size_t, GraphStatistics::CoverageBin>::const_iterator it = covHist.begin();
+                     it != covHist.end(); it++) {
+                        double St = it->first * COVERAGE_BIN_WIDTH;
+                        if (St > estimatedKmerCoverage+estimatedMKmerCoverageSTD*3)
+                                break;
+                        double representative = St + COVERAGE_BIN_WIDTH/2;
+                        const GraphStatistics::CoverageBin& bin = it->second;
+                        frequencyArray.push_back(make_pair(make_pair(bin.sumLength, bin.sumCorrectLength),
+                                                           make_pair(representative, bin.numNodes)));
+                }
+                if (frequencyArray.size()>0)
+                        plotCovDiagram(frequencyArray);
         }
-        if (frequencyArray.size()>0)
-                plotCovDiagram(frequencyArray);
         #endif
         /*............read line ...........*/
         double ratio=1;
@@ -233,9 +219,9 @@ void DBGraph::updateCutOffValue(int round)
 
         this->updateCutOffValueRound++;
 
-        cout << "Certain value: " << this->certainVlueCov << endl;
-        cout << "Safe value: " << this->safeValueCov << endl;
-        cout << "Red line value: " << this->redLineValueCov << endl;
+        getLog() << "Certain value: " << this->certainVlueCov << endl;
+        getLog() << "Safe value: " << this->safeValueCov << endl;
+        getLog() << "Red line value: " << this->redLineValueCov << endl;
 }
 void DBGraph::plotCovDiagram(vector<pair< pair< int , int> , pair<double,int> > >& frequencyArray){
 
@@ -292,12 +278,13 @@ void DBGraph::sanityCheck()
         // shortcuts
         SSNode n = getSSNode(i);
 
-        string sequence = n.getSequence();
         if (!n.isValid()) {
             if ((n.getNumLeftArcs() != 0) || (n.getNumRightArcs() != 0))
                 cerr << "\t\tNode " << n.getNodeID()
                      << " is invalid but has arcs." << endl;
+            continue;
         }
+        string sequence = n.getSequence();
         // check the continuity of the kmers
         Kmer firstKmer(sequence);
         for (ArcIt it = n.leftBegin(); it != n.leftEnd(); it++) {
@@ -510,6 +497,7 @@ void DBGraph::createFromFile(const string& nodeFilename,
 
     nodes = new DSNode[numNodes+1];
     SSNode::setNodePointer(nodes);
+    DSNode::setSequencePool(&seqPool);
     for (NodeID id = 1; id <= numNodes; id++) {
         // read the node info
         nodeFile >> dS >> dI >> length >> expMult >> readStartCov >> descriptor;
@@ -736,91 +724,616 @@ void DBGraph::writeGraph(const std::string& nodeFilename,
              << numExtractedArcs << " arcs." << endl;
 }
 
-void DBGraph::writeGraphBin(const std::string& nodeFilename,
-                            const std::string& arcFilename,
-                            const std::string& metaDataFilename)
+uint64_t DBGraph::writeGraphBin(const std::string& filename)
 {
-        // A) Write node file
-        ofstream nodeFile(nodeFilename.c_str(), ios::binary);
+        ofstream ofs(filename.c_str(), ios::binary);
+        if (!ofs)
+                throw ios_base::failure("Can't open " + filename);
+
+        // renumber the valid nodes consecutively
+        vector<NodeID> newID(numNodes + 1, 0);
+        NodeID numValidNodes = 0;
+        for (NodeID id = 1; id <= numNodes; id++)
+                if (getDSNode(id).isValid())
+                        newID[id] = ++numValidNodes;
+
+        GraphBinHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, GRAPHBIN_MAGIC, sizeof(header.magic));
+        header.version = GRAPHBIN_VERSION;
+        header.kmerSize = Kmer::getK();
+        header.numNodes = numValidNodes;
+        header.nodeOffset = sizeof(GraphBinHeader);
+        header.nodeChecksum = GRAPHBIN_CHECKSUM_SEED;
+        header.arcChecksum = GRAPHBIN_CHECKSUM_SEED;
+        header.seqChecksum = GRAPHBIN_CHECKSUM_SEED;
+
+        // the header is written last, when all offsets are known
+        ofs.write((char*)&header, sizeof(header));
+
+        // A) node records
+        ArcID arcOffset = 1;
+        uint64_t seqOffset = 0;
         for (NodeID id = 1; id <= numNodes; id++) {
-                DSNode& node = getDSNode(id);
-                // write the node contents
-                node.write(nodeFile);
+                const DSNode& node = getDSNode(id);
+                if (!node.isValid())
+                        continue;
+
+                GraphBinNode rec;
+                memset(&rec, 0, sizeof(rec));
+                rec.seqOffset = seqOffset;
+                rec.expMult = node.getExpMult();
+                rec.length = node.getLength();
+                rec.kmerCov = node.getKmerCov();
+                rec.readStartCov = node.getReadStartCov();
+                rec.leftID = arcOffset;
+                rec.rightID = arcOffset + node.getNumLeftArcs();
+                rec.arcInfo = node.getArcInfo();
+
+                arcOffset += node.getNumLeftArcs() + node.getNumRightArcs();
+                seqOffset += (node.getLength() + 3) / 4;
+
+                ofs.write((char*)&rec, sizeof(rec));
+                header.nodeChecksum = graphBinChecksum(&rec, sizeof(rec),
+                                                       header.nodeChecksum);
         }
-        nodeFile.close();
 
-        // B) Write arc file
-        ofstream arcFile(arcFilename.c_str(), ios::binary);
-        for (ArcID i = 0; i < numArcs+2; i++)
-                arcs[i].write(arcFile);
-        arcFile.close();
+        // B) arc records, sorted by nucleotide as in createFromFile
+        header.numArcs = arcOffset - 1;
+        header.arcOffset = header.nodeOffset +
+                           numValidNodes * sizeof(GraphBinNode);
 
-        // C) Write metadata file
-        ofstream metadataFile(metaDataFilename.c_str());
-        metadataFile << numNodes << "\t" << numArcs << endl;
-        metadataFile.close();
+        GraphBinArc empty = {0, 0};
+        ofs.write((char*)&empty, sizeof(empty));
+        header.arcChecksum = graphBinChecksum(&empty, sizeof(empty),
+                                              header.arcChecksum);
 
-        cout << "Wrote " << numNodes << " nodes and "
-             << numArcs << " arcs" << endl;
-}
+        for (NodeID id = 1; id <= numNodes; id++) {
+                SSNode node = getSSNode(id);
+                if (!node.isValid())
+                        continue;
 
-void DBGraph::loadGraphBin(const std::string& nodeFilename,
-                           const std::string& arcFilename,
-                           const std::string& metaDataFilename)
-{
-        // auxiliary variables
-        string dS, descriptor;
+                for (int side = 0; side < 2; side++) {
+                        ArcIt begin = (side == 0) ? node.leftBegin() : node.rightBegin();
+                        ArcIt end = (side == 0) ? node.leftEnd() : node.rightEnd();
+
+                        // at most one arc per nucleotide on each side
+                        GraphBinArc nodeArcs[4];
+                        bool present[4] = {false, false, false, false};
+                        for (ArcIt it = begin; it != end; it++) {
+                                SSNode t = getSSNode(it->getNodeID());
+                                char c = (side == 0) ?
+                                        t.getRightKmer().peekNucleotideLeft() :
+                                        t.getLeftKmer().peekNucleotideRight();
+                                int n = Nucleotide::charToNucleotide(c);
+
+                                NodeID tID = newID[abs(it->getNodeID())];
+                                nodeArcs[n].nodeID = (it->getNodeID() > 0) ? tID : -tID;
+                                nodeArcs[n].coverage = it->getCoverage();
+                                present[n] = true;
+                        }
+
+                        for (int n = 0; n < 4; n++) {
+                                if (!present[n])
+                                        continue;
+                                ofs.write((char*)&nodeArcs[n], sizeof(GraphBinArc));
+                                header.arcChecksum = graphBinChecksum(&nodeArcs[n],
+                                        sizeof(GraphBinArc), header.arcChecksum);
+                        }
+                }
+        }
+
+        ofs.write((char*)&empty, sizeof(empty));
+        header.arcChecksum = graphBinChecksum(&empty, sizeof(empty),
+                                              header.arcChecksum);
+
+        // C) sequence blob
+        header.seqOffset = header.arcOffset +
+                           (header.numArcs + 2) * sizeof(GraphBinArc);
+        header.seqSize = seqOffset;
+        for (NodeID id = 1; id <= numNodes; id++) {
+                const DSNode& node = getDSNode(id);
+                if (!node.isValid())
+                        continue;
+
+                const uint8_t *data = node.getTSequence().getData();
+                size_t numBytes = (node.getLength() + 3) / 4;
+                ofs.write((const char*)data, numBytes);
+                header.seqChecksum = graphBinChecksum(data, numBytes,
+                                                      header.seqChecksum);
+        }
+
+        header.headerChecksum = graphBinChecksum(&header,
+                offsetof(GraphBinHeader, headerChecksum));
+        ofs.seekp(0);
+        ofs.write((char*)&header, sizeof(header));
+
+        if (!ofs)
+                throw ios_base::failure("Can't write " + filename);
+        ofs.close();
 
-        // read the metadata
-        ifstream metaDataFile(metaDataFilename.c_str());
-        if (!metaDataFile)
-                throw ios_base::failure("Can't open " + metaDataFilename);
-        metaDataFile >> numNodes >> numArcs;
-        metaDataFile.close();
+        cout << "Wrote " << header.numNodes << " nodes and "
+             << header.numArcs << " arcs" << endl;
 
-        // A) create the nodes
-        ifstream nodeFile(nodeFilename.c_str(), ios::binary);
-        if (!nodeFile)
-                throw ios_base::failure("Can't open " + nodeFilename);
+        return header.headerChecksum;
+}
 
+void DBGraph::loadGraphBin(const std::string& filename)
+{
+        graphFile.open(filename);
+        uint8_t *data = graphFile.getData();
+        size_t size = graphFile.getSize();
+
+        // check the header
+        const string error = filename + " is not a valid binary graph file";
+        if (size < sizeof(GraphBinHeader))
+                throw ios_base::failure(error);
+
+        const GraphBinHeader& header = *(const GraphBinHeader*)data;
+        if (memcmp(header.magic, GRAPHBIN_MAGIC, sizeof(header.magic)) != 0)
+                throw ios_base::failure(error);
+        if (header.headerChecksum != graphBinChecksum(&header,
+                offsetof(GraphBinHeader, headerChecksum)))
+                throw ios_base::failure(error + " (corrupt header)");
+        if (header.version != GRAPHBIN_VERSION)
+                throw ios_base::failure(error + " (unsupported version)");
+        if (header.kmerSize != Kmer::getK())
+                throw ios_base::failure(filename + " was built using a "
+                                        "different kmer size");
+
+        size_t nodeSize = header.numNodes * sizeof(GraphBinNode);
+        size_t arcSize = (header.numArcs + 2) * sizeof(GraphBinArc);
+        if ((header.nodeOffset + nodeSize > size) ||
+            (header.arcOffset + arcSize > size) ||
+            (header.seqOffset + header.seqSize > size))
+                throw ios_base::failure(error + " (truncated)");
+
+        const GraphBinNode *nodeRec = (const GraphBinNode*)(data + header.nodeOffset);
+        const GraphBinArc *arcRec = (const GraphBinArc*)(data + header.arcOffset);
+        uint8_t *seqBlob = data + header.seqOffset;
+
+        if ((header.nodeChecksum != graphBinChecksum(nodeRec, nodeSize)) ||
+            (header.arcChecksum != graphBinChecksum(arcRec, arcSize)) ||
+            (header.seqChecksum != graphBinChecksum(seqBlob, header.seqSize)))
+                throw ios_base::failure(error + " (checksum mismatch)");
+
+        numNodes = header.numNodes;
+        numArcs = header.numArcs;
+
+        // A) create the nodes, their sequences point into the mapped file
         nodes = new DSNode[numNodes+1];
         SSNode::setNodePointer(nodes);
+        DSNode::setSequencePool(&seqPool);
+        seqPool.addBorrowedSlab(header.seqSize);
         for (NodeID id = 1; id <= numNodes; id++) {
-                // read the node info
-
+                const GraphBinNode& rec = nodeRec[id-1];
                 DSNode& node = getDSNode(id);
-                node.read(nodeFile);
+
+                node.setSequenceSlice(seqBlob + rec.seqOffset, rec.length);
+                node.setExpMult(rec.expMult);
+                node.setKmerCov(rec.kmerCov);
+                node.setReadStartCov(rec.readStartCov);
+                node.setFirstLeftArcID(rec.leftID);
+                node.setFirstRightArcID(rec.rightID);
+                node.setArcInfo(rec.arcInfo);
         }
-        nodeFile.close();
 
         // B) create the arcs
-        ifstream arcFile(arcFilename.c_str());
-        if (!arcFile)
-                throw ios_base::failure("Can't open " + arcFilename);
-
         // +2 because index 0 isn't used, final index denotes 'end'.
         arcs = new Arc[numArcs+2];
         DSNode::setArcsPointer(arcs);
+        for (ArcID i = 0; i < numArcs+2; i++) {
+                arcs[i].setNodeID(arcRec[i].nodeID);
+                arcs[i].setCoverage(arcRec[i].coverage);
+        }
+}
+
+string DBGraph::getCheckpointFilename(int slot, const char* extension) const
+{
+        ostringstream oss;
+        oss << checkpointPrefix << "." << slot << "." << extension;
+        return oss.str();
+}
+
+void DBGraph::writeCheckpoint(int round)
+{
+        if (checkpointPrefix.empty())
+                return;
+
+        int slot = round % 2;
+        string graphFilename = getCheckpointFilename(slot, "bin");
+        string stateFilename = getCheckpointFilename(slot, "state");
+
+        // invalidate the slot before its graph file is replaced
+        remove(stateFilename.c_str());
+
+        CheckpointHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+        header.version = CHECKPOINT_VERSION;
+        header.round = round;
+        header.sourceChecksum = checkpointSource;
+        header.purificationMode = checkpointMode;
+        header.graphChecksum = writeGraphBin(graphFilename + ".tmp");
+        if (rename((graphFilename + ".tmp").c_str(), graphFilename.c_str()) != 0)
+                throw ios_base::failure("Can't rename " + graphFilename + ".tmp");
+
+        header.estimatedKmerCoverage = estimatedKmerCoverage;
+        header.estimatedMKmerCoverageSTD = estimatedMKmerCoverageSTD;
+        header.cutOffvalue = cutOffvalue;
+        header.certainVlueCov = certainVlueCov;
+        header.safeValueCov = safeValueCov;
+        header.redLineValueCov = redLineValueCov;
+        header.readLength = readLength;
+        header.readStartCovPerBase = readStartCovPerBase;
+        header.maxNodeSizeToDel = maxNodeSizeToDel;
+        header.updateCutOffValueRound = updateCutOffValueRound;
+
+        // multiplicities of the valid nodes, numbered as in writeGraphBin
+        vector<CheckpointMult> mult;
+        for (NodeID id = 1; id <= numNodes; id++) {
+                if (!getDSNode(id).isValid())
+                        continue;
+                CheckpointMult rec;
+                memset(&rec, 0, sizeof(rec));
+                if ((size_t)id < nodesExpMult.size()) {
+                        rec.multiplicity = nodesExpMult[id].first;
+                        rec.confidenceRatio = nodesExpMult[id].second.first;
+                        rec.inCorrctnessRatio = nodesExpMult[id].second.second;
+                }
+#ifdef DEBUG
+                if ((size_t)id < trueMult.size())
+                        rec.trueMultiplicity = trueMult[id];
+#endif
+                mult.push_back(rec);
+        }
+        header.numMultRecords = mult.size();
+
+        uint64_t checksum = graphBinChecksum(&header, sizeof(header));
+        checksum = graphBinChecksum(mult.data(),
+                mult.size() * sizeof(CheckpointMult), checksum);
+
+        ofstream ofs((stateFilename + ".tmp").c_str(), ios::binary);
+        if (!ofs)
+                throw ios_base::failure("Can't open " + stateFilename + ".tmp");
+        ofs.write((char*)&header, sizeof(header));
+        ofs.write((char*)mult.data(), mult.size() * sizeof(CheckpointMult));
+        ofs.write((char*)&checksum, sizeof(checksum));
+        if (!ofs)
+                throw ios_base::failure("Can't write " + stateFilename + ".tmp");
+        ofs.close();
+
+        if (rename((stateFilename + ".tmp").c_str(), stateFilename.c_str()) != 0)
+                throw ios_base::failure("Can't rename " + stateFilename + ".tmp");
+
+        getLog() << "Wrote checkpoint after round " << round << endl;
+}
+
+/**
+ * Read a checkpoint state file
+ * @param filename State filename
+ * @param header Checkpoint header (output)
+ * @param mult Multiplicity records (output)
+ * @return True if the file is complete and its checksum matches
+ */
+static bool readCheckpointState(const string& filename,
+                                CheckpointHeader& header,
+                                vector<CheckpointMult>& mult)
+{
+        ifstream ifs(filename.c_str(), ios::binary);
+        if (!ifs.read((char*)&header, sizeof(header)))
+                return false;
+        if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0)
+                return false;
+        if (header.version != CHECKPOINT_VERSION || header.numMultRecords < 0)
+                return false;
+
+        mult.resize(header.numMultRecords);
+        uint64_t checksum;
+        if (!ifs.read((char*)mult.data(), mult.size() * sizeof(CheckpointMult)))
+                return false;
+        if (!ifs.read((char*)&checksum, sizeof(checksum)))
+                return false;
+
+        uint64_t expected = graphBinChecksum(&header, sizeof(header));
+        expected = graphBinChecksum(mult.data(),
+                mult.size() * sizeof(CheckpointMult), expected);
+
+        return checksum == expected;
+}
+
+int DBGraph::loadCheckpoint()
+{
+        if (checkpointPrefix.empty())
+                return 0;
+
+        CheckpointHeader header[2];
+        vector<CheckpointMult> mult[2];
+        bool valid[2];
+        for (int slot = 0; slot < 2; slot++) {
+                valid[slot] = readCheckpointState(getCheckpointFilename(slot, "state"),
+                                                  header[slot], mult[slot]) &&
+                              header[slot].sourceChecksum == checkpointSource &&
+                              header[slot].purificationMode == checkpointMode &&
+                              header[slot].graphChecksum == readGraphBinChecksum(
+                                      getCheckpointFilename(slot, "bin"));
+        }
+
+        // try the most recent checkpoint first
+        int order[2] = {0, 1};
+        if (valid[1] && (!valid[0] || header[1].round > header[0].round))
+                swap(order[0], order[1]);
+
+        for (int i = 0; i < 2; i++) {
+                int slot = order[i];
+                if (!valid[slot])
+                        continue;
+
+                try {
+                        loadGraphBin(getCheckpointFilename(slot, "bin"));
+                } catch (ios_base::failure& e) {
+                        cerr << "Ignoring checkpoint: " << e.what() << endl;
+                        clear();
+                        continue;
+                }
+
+                if (header[slot].numMultRecords != numNodes) {
+                        clear();
+                        continue;
+                }
+
+                const CheckpointHeader& h = header[slot];
+                estimatedKmerCoverage = h.estimatedKmerCoverage;
+                estimatedMKmerCoverageSTD = h.estimatedMKmerCoverageSTD;
+                cutOffvalue = h.cutOffvalue;
+                certainVlueCov = h.certainVlueCov;
+                safeValueCov = h.safeValueCov;
+                redLineValueCov = h.redLineValueCov;
+                readLength = h.readLength;
+                readStartCovPerBase = h.readStartCovPerBase;
+                maxNodeSizeToDel = h.maxNodeSizeToDel;
+                updateCutOffValueRound = h.updateCutOffValueRound;
+
+                nodesExpMult.assign(numNodes + 1, make_pair(0, make_pair(0.0, 0.0)));
+                for (NodeID id = 1; id <= numNodes; id++) {
+                        const CheckpointMult& rec = mult[slot][id-1];
+                        nodesExpMult[id] = make_pair(rec.multiplicity,
+                                make_pair(rec.confidenceRatio, rec.inCorrctnessRatio));
+                }
+#ifdef DEBUG
+                trueMult.assign(numNodes + 1, 0);
+                for (NodeID id = 1; id <= numNodes; id++)
+                        trueMult[id] = mult[slot][id-1].trueMultiplicity;
+#endif
+
+                return h.round;
+        }
+
+        return 0;
+}
+
+void DBGraph::removeCheckpoints() const
+{
+        for (int slot = 0; slot < 2; slot++) {
+                remove(getCheckpointFilename(slot, "state").c_str());
+                remove(getCheckpointFilename(slot, "bin").c_str());
+                remove((getCheckpointFilename(slot, "state") + ".tmp").c_str());
+                remove((getCheckpointFilename(slot, "bin") + ".tmp").c_str());
+        }
+}
+
+void DBGraph::cloneFrom(const DBGraph& src)
+{
+        clear();
+
+        numNodes = src.numNodes;
+        numArcs = src.numArcs;
+
+        nodes = new DSNode[numNodes+1];
+        for (NodeID id = 1; id <= numNodes; id++)
+                nodes[id].shareFrom(src.nodes[id]);
+
+        // +2 because index 0 isn't used, final index denotes 'end'.
+        arcs = new Arc[numArcs+2];
         for (ArcID i = 0; i < numArcs+2; i++)
-                arcs[i].read(arcFile);
-        arcFile.close();
+                arcs[i] = src.arcs[i];
+
+        // modified sequences are stored in our own slabs
+        seqPool.addBorrowedSlab(src.seqPool.getNumBytesLive(), true);
+
+        activate();
+}
+
+void DBGraph::activate() const
+{
+        DBGraph::graph = this;
+        SSNode::setNodePointer(nodes);
+        DSNode::setArcsPointer(arcs);
+        // the pool is only modified through non-const graph routines
+        DSNode::setSequencePool(const_cast<SequencePool*>(&seqPool));
+}
+
+void DBGraph::prepareWorkspaces(size_t numWorkspaces)
+{
+        if (workspaces.size() < numWorkspaces)
+                workspaces.resize(numWorkspaces);
+
+        // the workspaces are resized when the graph is compacted or reloaded
+        for (size_t i = 0; i < workspaces.size(); i++)
+                if (workspaces[i].getNumNodes() != numNodes)
+                        workspaces[i].resize(numNodes);
+}
+
+NodeID DBGraph::getNumValidNodes() const
+{
+        NodeID numValidNodes = 0;
+        for (NodeID id = 1; id <= numNodes; id++)
+                if (getDSNode(id).isValid())
+                        numValidNodes++;
+        return numValidNodes;
+}
+
+void DBGraph::compactGraph()
+{
+        // renumber the valid nodes consecutively
+        vector<NodeID> newID(numNodes + 1, 0);
+        NodeID numValidNodes = 0;
+        ArcID numValidArcs = 0;
+        for (NodeID id = 1; id <= numNodes; id++) {
+                const DSNode& node = getDSNode(id);
+                if (!node.isValid())
+                        continue;
+                newID[id] = ++numValidNodes;
+                numValidArcs += node.getNumLeftArcs() + node.getNumRightArcs();
+        }
+
+        // A) create the new nodes and arcs, keeping the arc order per node
+        DSNode *newNodes = new DSNode[numValidNodes+1];
+        Arc *newArcs = new Arc[numValidArcs+2];
+        ArcID arcOffset = 1;
+        for (NodeID id = 1; id <= numNodes; id++) {
+                const DSNode& node = getDSNode(id);
+                if (!node.isValid())
+                        continue;
+
+                DSNode& newNode = newNodes[newID[id]];
+                newNode.shareFrom(node);
+
+                newNode.setFirstLeftArcID(arcOffset);
+                for (ArcIt it = node.leftBegin(); it != node.leftEnd(); it++) {
+                        NodeID tID = newID[abs(it->getNodeID())];
+                        newArcs[arcOffset].setNodeID((it->getNodeID() > 0) ? tID : -tID);
+                        newArcs[arcOffset++].setCoverage(it->getCoverage());
+                }
+
+                newNode.setFirstRightArcID(arcOffset);
+                for (ArcIt it = node.rightBegin(); it != node.rightEnd(); it++) {
+                        NodeID tID = newID[abs(it->getNodeID())];
+                        newArcs[arcOffset].setNodeID((it->getNodeID() > 0) ? tID : -tID);
+                        newArcs[arcOffset++].setCoverage(it->getCoverage());
+                }
+        }
+
+        // B) copy the sequences to a fresh pool
+        SequencePool newPool;
+        for (NodeID id = 1; id <= numValidNodes; id++)
+                newNodes[id].moveSequence(newPool);
+
+        // C) renumber the per-node bookkeeping
+        if (!nodesExpMult.empty()) {
+                vector<pair_k> newExpMult(numValidNodes + 1, make_pair(0, make_pair(0.0, 0.0)));
+                for (NodeID id = 1; id < (NodeID)nodesExpMult.size(); id++)
+                        if (id <= numNodes && newID[id] != 0)
+                                newExpMult[newID[id]] = nodesExpMult[id];
+                nodesExpMult.swap(newExpMult);
+        }
+
+        // the change log keeps its length, so that the cursors remain valid
+        for (size_t i = 0; i < changeLog.size(); i++)
+                changeLog[i] = newID[changeLog[i]];
+        vector<NodeID> newDeadEnds;
+        for (size_t i = 0; i < deadEnds.size(); i++)
+                if (newID[deadEnds[i]] != 0)
+                        newDeadEnds.push_back(newID[deadEnds[i]]);
+        deadEnds.swap(newDeadEnds);
+
+#ifdef DEBUG
+        if (!trueMult.empty()) {
+                vector<int> newTrueMult(numValidNodes + 1, 0);
+                for (NodeID id = 1; id <= numNodes; id++)
+                        if (newID[id] != 0)
+                                newTrueMult[newID[id]] = trueMult[id];
+                trueMult.swap(newTrueMult);
+        }
+#endif
+
+        statsValid = false;
+
+        getLog() << "Compacted graph from " << numNodes << " to "
+                 << numValidNodes << " nodes" << endl;
+
+        delete [] nodes;
+        delete [] arcs;
+        nodes = newNodes;
+        arcs = newArcs;
+        numNodes = numValidNodes;
+        numArcs = numValidArcs;
+
+        // the old slabs are freed when newPool goes out of scope
+        seqPool.swap(newPool);
+        graphFile.close();
+
+        activate();
+}
+
+void DBGraph::compactSequences()
+{
+        SequencePool newPool;
+        for (NodeID id = 1; id <= numNodes; id++)
+                getDSNode(id).moveSequence(newPool);
+
+#ifdef DEBUG
+        cout << "Compacted node sequences from "
+             << seqPool.getNumBytesAllocated() << " to "
+             << newPool.getNumBytesAllocated() << " bytes" << endl;
+#endif
+        // the old slabs are freed when newPool goes out of scope
+        seqPool.swap(newPool);
+
+        // no sequence refers to the mapped graph file anymore
+        graphFile.close();
+}
+
+void DBGraph::addNodeStatistics(NodeID nodeID)
+{
+        if (!statsValid)
+                return;
+
+        const DSNode& node = getDSNode(abs(nodeID));
+        size_t marginalLength = node.getMarginalLength();
+        double nodeKmerCov = (marginalLength > 0) ?
+                (double)node.getKmerCov() / (double)marginalLength : 0.0;
+        bool correct = false;
+#ifdef DEBUG
+        correct = (trueMult.size() > 0 && trueMult[abs(nodeID)] > 0);
+#endif
+        stats.addNode(abs(nodeID), marginalLength, nodeKmerCov, correct);
+}
+
+void DBGraph::removeNodeStatistics(NodeID nodeID)
+{
+        if (statsValid && stats.contains(abs(nodeID)))
+                stats.removeNode(abs(nodeID));
+}
+
+void DBGraph::updateStatistics()
+{
+        if (statsValid)
+                return;
+
+        stats.reset(numNodes);
+        statsValid = true;
+        for (NodeID id = 1; id <= numNodes; id++)
+                if (getDSNode(id).isValid())
+                        addNodeStatistics(id);
 }
 
 size_t DBGraph::updateGraphSize()
 {
-    vector<size_t> nodeLengths;
+    updateStatistics();
 
-    sizeOfGraph=0;
-    size_t numExtractedNodes = 0, numExtractedArcs = 0;
+    //check later for adding kmerSize
+    sizeOfGraph = stats.getTotalMarginalLength() + stats.getNumNodes() * Kmer::getK();
+    if (stats.getNumNodes() > 0)
+        n50 = stats.getN50(Kmer::getK() - 1);
+
+#ifdef DEBUG
+    size_t numExtractedArcs = 0;
     for (NodeID id = 1; id <= numNodes; id++) {
         SSNode node = getSSNode(id);
-
         if (!node.isValid())
             continue;
 
-        numExtractedNodes++;
-        //check later for adding kmerSize
-        sizeOfGraph=sizeOfGraph +node.getMarginalLength()+ Kmer::getK();
         KmerOverlap ol;
         for (ArcIt it = node.leftBegin(); it != node.leftEnd(); it++) {
             char c = getSSNode(it->getNodeID()).getRightKmer().peekNucleotideLeft();
@@ -832,38 +1345,13 @@ size_t DBGraph::updateGraphSize()
             ol.markRightOverlap(c);
         }
         numExtractedArcs += ol.getNumLeftOverlap() + ol.getNumRightOverlap();
-
-        nodeLengths.push_back(node.getLength());
     }
 
-
-#ifdef DEBUG
     cout<<"size of graph: "<<sizeOfGraph<<endl;
-    cout<<"number of valid Node: "<<numExtractedNodes<<endl;
-    cout << "Extracted " << numExtractedNodes << " nodes and "
+    cout<<"number of valid Node: "<<stats.getNumNodes()<<endl;
+    cout << "Extracted " << stats.getNumNodes() << " nodes and "
          << numExtractedArcs << " arcs." << endl;
-#endif
-    sort(nodeLengths.begin(), nodeLengths.end());
-
-    size_t totalLength = 0;
-    for (size_t i = 0; i < nodeLengths.size(); i++)
-        totalLength += nodeLengths[i];
-    size_t currLength = 0;
-    size_t n50;
-    for (size_t i = 0; i < nodeLengths.size(); i++) {
-        currLength += nodeLengths[i];
-        if (currLength >= 0.5*totalLength) {
-#ifdef DEBUG
-            cout << endl << "N50 is " << nodeLengths[i] << " (total length: " << totalLength << ")" << endl;
-            cout << "This was found at node " << i << "/" << numNodes << endl;
-#endif
-            n50= nodeLengths[i];
-            this->n50=n50;
-            break;
-        }
-    }
-#ifdef DEBUG
-    cout << "The largest node contains " << nodeLengths.back() << " basepairs." << endl;
+    cout << "The largest node contains " << stats.getMaxLength(Kmer::getK() - 1) << " basepairs." << endl;
     cout <<"N50:"<<n50<<endl;
 #endif
     return sizeOfGraph;
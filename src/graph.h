@@ -24,7 +24,12 @@
 #include "global.h"
 #include "ssnode.h"
 #include "dsnode.h"
+#include "seqpool.h"
+#include "graphbin.h"
+#include "traversal.h"
+#include "graphstats.h"
 #include <deque>
+#include <atomic>
 #include "essaMEM-master/sparseSA.hpp"
 
 
@@ -50,6 +55,24 @@ class NodeEndTable;
 class NodeEndRef;
 class LibraryContainer;
 
+// ============================================================================
+// BUBBLE CANDIDATE
+// ============================================================================
+
+/**
+ * Result of a bubble search from a single root, together with the nodes
+ * the search has visited. A pair of parallel paths closes at the length of
+ * the path at which the search detected it; a search to a smaller depth
+ * finds exactly the pairs that close within that depth.
+ */
+struct BubbleCandidate {
+        NodeID rootID;                  // root of the search
+        std::vector<std::pair<std::vector<NodeID>, std::vector<NodeID> > > parallelPaths;
+        std::vector<size_t> closeDepth; // depth at which each pair closes
+        std::vector<NodeID> footprint;  // nodes visited by the search
+        size_t searchTime;              // time at which the search was done
+};
+
 // ============================================================================
 // GRAPH CLASS
 // ============================================================================
@@ -172,6 +195,25 @@ private:
 
     DSNode *nodes;          // graph nodes
     Arc *arcs;              // graph arcs
+    SequencePool seqPool;   // storage for the node sequences
+    MappedFile graphFile;   // memory-mapped binary graph file
+    std::vector<TraversalWorkspace> workspaces;     // scratch per thread
+
+    std::vector<NodeID> changeLog;  // modified nodes, in order of change
+    size_t chainCursor;             // changes seen by mergeChains
+    bool chainsMerged;              // no chains left before chainCursor
+    size_t tipCursor;               // changes seen by clipTips
+    bool deadEndsKnown;             // deadEnds valid before tipCursor
+    std::vector<NodeID> deadEnds;   // dead-end nodes, sorted
+
+    GraphStatistics stats;          // statistics of the valid nodes
+    bool statsValid;                // true if stats is up to date
+
+    size_t numWorkerThreads;        // threads used by the purification passes
+    std::ostream* logStream;        // destination of progress messages
+    std::string checkpointPrefix;   // checkpoint files (empty: disabled)
+    uint64_t checkpointSource;      // header checksum of the input graph
+    uint32_t checkpointMode;        // purification mode (CHECKPOINT_MODE_*)
 
     NodeID numNodes;        // number of nodes
     NodeID numArcs;         // number of arcs
@@ -190,7 +232,7 @@ private:
 
 public:
 
-    static const DBGraph* graph;
+    static thread_local const DBGraph* graph;
     double estimatedKmerCoverage;
     double estimatedMKmerCoverageSTD;
     double minCertainVlueCov;
@@ -209,6 +251,9 @@ public:
     size_t n50;
     size_t sizeOfGraph;
 
+    double readStartCovPerBase;     // read start coverage per nucleotide
+    bool sharedCoverageModel;       // true if the coverage is not re-estimated
+
 
     /**
      * Careful concatenation, taking into account the estimated multiplicity
@@ -220,18 +265,182 @@ public:
  *
  */
     bool bubbleDetection(int round);
+
+    /**
+     * Remove bubbles at increasing depths, merging the node chains after
+     * every depth that deleted nodes, and stop at the first depth (after the
+     * first) that deletes nothing. Every root is searched only once at the
+     * maximum depth, unless the graph around it changes.
+     * @param depths Increasing bubble depths
+     * @return True if bubbles were removed at the first depth
+     */
+    bool bubbleDetection(const std::vector<size_t>& depths);
     vector<pair<SSNode, SSNode> >  ExtractBubbles(SSNode rootNode,std::set<NodeID>& visitedNodes , std::set<Arc *>&visitedArc);
     bool removeBubble(SSNode &prevFirstNode ,SSNode& extendFirstNode,size_t &TP,size_t &TN,size_t &FP,size_t &FN,size_t & numOfDel);
-    void extractPath(NodeID currID, const vector<NodeID>& prevNode) const;
-    vector<NodeID> getPath(NodeID currID, const vector<NodeID>& prevNode) const;
+    void extractPath(NodeID currID, const TraversalWorkspace& ws) const;
+    vector<NodeID> getPath(NodeID currID, const TraversalWorkspace& ws) const;
     bool removeNotSingleBubbles(  SSNode &prevFirstNode ,SSNode& extendFirstNode, size_t &TP,size_t &TN,size_t &FP,size_t &FN,size_t & numOfDel);
     bool whichOneIsbubble(SSNode rootNode,bool &first, SSNode &prevFirstNode ,SSNode& extendFirstNode, bool onlySingle, double threshold);
     bool whichOneIsbubble(SSNode rootNode,bool &first, SSNode &prevFirstNode ,SSNode& extendFirstNode, bool onlySingle);
     bool nodeIsBubble(SSNode node, SSNode currNode);
-    vector<pair<vector<NodeID>, vector<NodeID>> >  searchForParallelNodes(SSNode node,vector<NodeID> &visited, vector<NodeID> &prevNode,vector<NodeID> &nodeColor, int depth);
+    vector<pair<vector<NodeID>, vector<NodeID>> >  searchForParallelNodes(SSNode node, TraversalWorkspace& ws, int depth, vector<size_t>* closeDepth = NULL);
     vector<pair<vector<NodeID>, vector<NodeID>> > searchForParallelNodes(SSNode node, int depth);
     bool hasLowCovNode(SSNode root);
 
+    /**
+     * Check whether a node is a root for bubble detection
+     * @param lID Identifier of the (oriented) node
+     * @return True if the node branches and has a low coverage neighbour
+     */
+    bool isBubbleRoot(NodeID lID);
+
+    /**
+     * (Re)do the bubble search for a candidate
+     * @param cand Bubble candidate, the root identifier is set (input/output)
+     * @param ws Traversal workspace to use
+     * @param depth Maximum length of the parallel paths
+     * @param time Current time
+     */
+    void searchBubbleCandidate(BubbleCandidate& cand, TraversalWorkspace& ws,
+                               size_t depth, size_t time);
+
+    /**
+     * Search for bubbles from the branching roots in a range of nodes
+     * @param myID Unique threadID
+     * @param numThreads Total number of threads
+     * @param depth Maximum length of the parallel paths
+     * @param candidates Search result per root, in order of root (output)
+     */
+    void bubbleSearchThread(size_t myID, size_t numThreads, size_t depth,
+                            std::vector<BubbleCandidate>* candidates);
+
+    /**
+     * Search for bubbles from all roots in parallel
+     * @param depth Maximum length of the parallel paths
+     * @param candidates Search result per root, in order of root (output)
+     */
+    void findBubbleCandidates(size_t depth, std::vector<BubbleCandidate>& candidates);
+
+    /**
+     * Remove the bubbles of a single candidate that close within a depth
+     * @param cand Bubble candidate
+     * @param depth Current depth
+     * @param modifiedAt Per node time of the last modification (input/output)
+     * @param time Current time (input/output)
+     * @return The number of deleted nodes
+     */
+    size_t removeBubbles(const BubbleCandidate& cand, size_t depth,
+                         std::vector<size_t>& modifiedAt, size_t& time,
+                         size_t& TP, size_t& TN, size_t& FP, size_t& FN);
+
+    /**
+     * Remove the bubbles of all candidates in order of root, stale searches
+     * are redone first
+     * @param candidates Bubble candidates (input/output)
+     * @param depth Current depth
+     * @param searchDepth Depth of the searches of the candidates
+     * @param modifiedAt Per node time of the last modification (input/output)
+     * @param time Current time (input/output)
+     * @return The number of deleted nodes
+     */
+    size_t commitBubbles(std::vector<BubbleCandidate>& candidates, size_t depth,
+                         size_t searchDepth, std::vector<size_t>& modifiedAt,
+                         size_t& time);
+
+    /**
+     * Check whether a node can be merged with its right neighbour
+     * @param nodeID Identifier of the (oriented) node
+     * @return True if the right arc is the only connection between both
+     */
+    bool canMergeRight(NodeID nodeID) const;
+
+    /**
+     * Find the maximal non-branching chains that start in a range of nodes
+     * @param myID Unique threadID
+     * @param numThreads Total number of threads
+     * @param chains Chains found by this thread (output)
+     */
+    void findChainsThread(size_t myID, size_t numThreads,
+                          std::vector<std::vector<NodeID> >* chains) const;
+
+    /**
+     * Find the dead-end nodes in a range of nodes, these are the only
+     * tip candidates before any node is removed
+     * @param myID Unique threadID
+     * @param numThreads Total number of threads
+     * @param candidates Identifiers of the dead-end nodes, sorted (output)
+     * @param numValid Number of valid nodes in the range (output)
+     */
+    void findTipCandidatesThread(size_t myID, size_t numThreads,
+                                 std::vector<NodeID>* candidates,
+                                 size_t* numValid) const;
+
+    /**
+     * Estimate the multiplicity of a range of nodes from their read start
+     * coverage and store it, together with its certainty, in nodesExpMult
+     * @param myID Unique threadID
+     * @param numThreads Total number of threads
+     * @param avg Average read start coverage per nucleotide
+     */
+    void estimateMultiplicityThread(size_t myID, size_t numThreads, double avg);
+
+    /**
+     * Merge a chain of nodes into its first node, the merged sequence is
+     * built once from the 2-bit packed sequences of the chain
+     * @param chain Identifiers of the (oriented) nodes in the chain
+     * @param modifiedNodes Identifiers of the modified nodes and of the
+     * neighbours of the merged node (output, optional)
+     */
+    void mergeChain(const std::vector<NodeID>& chain,
+                    std::vector<NodeID>* modifiedNodes);
+
+    /**
+     * Find the maximal non-branching chains that contain a set of nodes
+     * @param nodeIDs Identifiers of the nodes (positive)
+     * @param chains Chains that contain one of those nodes (output)
+     */
+    void findChainsAround(const std::vector<NodeID>& nodeIDs,
+                          std::vector<std::vector<NodeID> >& chains) const;
+
+    /**
+     * Record that the arcs or the validity of a node have changed
+     * @param nodeID Identifier of the node
+     */
+    void logChange(NodeID nodeID) {
+        changeLog.push_back(abs(nodeID));
+    }
+
+    /**
+     * Get the nodes that changed since a position in the change log and
+     * move that position to the end of the log
+     * @param cursor Position in the change log (input/output)
+     * @param nodeIDs Identifiers of the changed nodes, sorted (output)
+     */
+    void getChangedNodes(size_t& cursor, std::vector<NodeID>& nodeIDs);
+
+    /**
+     * Count a valid node in the node statistics
+     * @param nodeID Identifier of the node
+     */
+    void addNodeStatistics(NodeID nodeID);
+
+    /**
+     * Remove a node from the node statistics, before it is changed
+     * @param nodeID Identifier of the node
+     */
+    void removeNodeStatistics(NodeID nodeID);
+
+    /**
+     * Forget all recorded changes, after which every pass that depends on
+     * them falls back to a full scan
+     */
+    void resetWorklists() {
+        changeLog.clear();
+        chainCursor = tipCursor = 0;
+        chainsMerged = deadEndsKnown = false;
+        deadEnds.clear();
+    }
+
 
  /**
  *fucntion associated to graph graph Purification
@@ -240,7 +449,24 @@ public:
  */
     bool removeNode(SSNode &rootNode);
     bool mergeSingleNodes(bool force);
+
+    /**
+     * Merge all maximal non-branching chains of nodes, the chains are
+     * detected in parallel and merged at once
+     * @param modifiedNodes Identifiers of the modified nodes and of the
+     * neighbours of the merged nodes (output, optional)
+     * @return True if any nodes were merged
+     */
+    bool mergeChains(std::vector<NodeID>* modifiedNodes = NULL);
     void extractStatistic(int round);
+
+    /**
+     * Estimate the k-mer coverage (mean and std) and the read start coverage
+     * per nucleotide from the 5% longest nodes
+     * @param round Purification round, the std is only set in round 0
+     * @return The read start coverage per nucleotide
+     */
+    double estimateCoverageModel(int round);
     bool checkNodeIsReliable(SSNode node);
     bool deleteUnreliableNodes();
     bool deleteExtraAttachedNodes();
@@ -284,6 +510,7 @@ public:
     /**
      * Compare the current graph to the solution
      * @param filename Filename of file containing true multiplicities
+     * @param load True to rebuild the true multiplicities of the nodes
      */
     void compareToSolution(const string& filename,bool load);
 
@@ -386,8 +613,70 @@ public:
         nodes = NULL;
         arcs = NULL;
         numNodes = numArcs = 0;
+        seqPool.clear();
+        graphFile.close();
+        workspaces.clear();
+        resetWorklists();
+        statsValid = false;
     }
 
+    /**
+     * Make sure there are enough traversal workspaces, sized for the
+     * current graph. Call this before starting threads that use them.
+     * @param numWorkspaces Minimum number of workspaces
+     */
+    void prepareWorkspaces(size_t numWorkspaces);
+
+    /**
+     * Get the traversal workspace of a thread
+     * @param threadID Unique threadID (0 for serial code)
+     * @return The traversal workspace of that thread
+     */
+    TraversalWorkspace& getWorkspace(size_t threadID) {
+        return workspaces[threadID];
+    }
+
+    /**
+     * Make this graph a copy of another graph. The node sequences are
+     * shared with the other graph and copied only when they are modified,
+     * so the other graph must outlive this copy. The copy is activated.
+     * @param src Graph to copy
+     */
+    void cloneFrom(const DBGraph& src);
+
+    /**
+     * Point the static node, arc and sequence pool pointers to this graph.
+     * These pointers are per thread: every thread that accesses the graph
+     * must activate it first.
+     */
+    void activate() const;
+
+    /**
+     * Make sure the node statistics are up to date. They are computed from
+     * scratch after the graph was created, cloned or compacted and kept up
+     * to date while nodes are removed or merged.
+     */
+    void updateStatistics();
+
+    /**
+     * Count the number of valid nodes
+     * @return The number of valid nodes
+     */
+    NodeID getNumValidNodes() const;
+
+    /**
+     * Remove the invalid nodes and deleted arcs from the graph. The valid
+     * nodes are renumbered consecutively (preserving their order), the
+     * arc array is rebuilt and the node sequences are compacted.
+     */
+    void compactGraph();
+
+    /**
+     * Copy the sequences of all valid nodes to a fresh sequence pool,
+     * thus reclaiming the space of deleted and merged nodes
+     */
+    void compactSequences();
+
     /**
      * Perform graph simplification
      */
@@ -433,24 +722,19 @@ public:
                     const std::string& metaDataFilename);
 
     /**
-     * Write graph to file (binary version)
-     * @param nodeFilename node filename
-     * @param arcFilename arc filename
-     * @param metaDataFilename Metadata filename
+     * Write the valid nodes and their arcs to a binary graph file. The
+     * nodes are renumbered consecutively.
+     * @param filename Binary graph filename
+     * @return The header checksum of the file
      */
-    void writeGraphBin(const std::string& nodeFilename,
-                       const std::string& arcFilename,
-                       const std::string& metaDataFilename);
+    uint64_t writeGraphBin(const std::string& filename);
 
     /**
-     * Load graph to file (binary version)
-     * @param nodeFilename node filename
-     * @param arcFilename arc filename
-     * @param metaDataFilename Metadata filename
+     * Load a graph from a binary graph file. The file is memory-mapped
+     * and the node sequences refer directly to the mapped sequence blob.
+     * @param filename Binary graph filename
      */
-    void loadGraphBin(const std::string& nodeFilename,
-                      const std::string& arcFilename,
-                      const std::string& metaDataFilename);
+    void loadGraphBin(const std::string& filename);
 
     size_t updateGraphSize();
 
@@ -472,7 +756,7 @@ public:
     //map<int,set<NodeID> >readToKmerSearch;
     //the first argument is node multiplicity,in the second pair the first argumument is confidense ratio for this multiplicity and the second argument is for correctntss ratio of gueess
     typedef pair<int, pair<double, double> > pair_k;
-    map<NodeID, pair_k> nodesExpMult;
+    std::vector<pair_k> nodesExpMult;    // indexed by node identifier
     typedef multimap<NodeID, pair_k>::iterator mapIterator;
 
     /**
@@ -500,8 +784,118 @@ public:
      */
     void writeGraphFasta() const;
 
+    /**
+     * Purify the graph in rounds until no more changes are made
+     * @param trueMultFilename File with the true multiplicities (DEBUG)
+     * @param libraries Library container
+     * @param firstRound Round to start from (> 1 when resuming)
+     */
     void graphPurification(string trueMultFilename,
-                           const LibraryContainer& libraries);
+                           const LibraryContainer& libraries,
+                           int firstRound = 1);
+
+    /**
+     * Write a checkpoint after each purification round. Checkpoints
+     * alternate between two slots so that the previous one survives an
+     * interrupted write.
+     * @param prefix Prefix of the checkpoint filenames
+     * @param sourceChecksum Header checksum of the input graph file
+     * @param mode Purification mode (CHECKPOINT_MODE_*)
+     */
+    void enableCheckpoints(const std::string& prefix, uint64_t sourceChecksum,
+                           uint32_t mode) {
+        checkpointPrefix = prefix;
+        checkpointSource = sourceChecksum;
+        checkpointMode = mode;
+    }
+
+    /**
+     * Get the name of a checkpoint file
+     * @param slot Checkpoint slot (0 or 1)
+     * @param extension Filename extension ("bin" or "state")
+     * @return The filename
+     */
+    std::string getCheckpointFilename(int slot, const char* extension) const;
+
+    /**
+     * Write the graph and the purification state to a checkpoint
+     * @param round Last completed purification round
+     */
+    void writeCheckpoint(int round);
+
+    /**
+     * Load the graph and the purification state from the most recent
+     * valid checkpoint of the same input graph and purification mode, if any
+     * @return The last completed round (0 if no valid checkpoint exists)
+     */
+    int loadCheckpoint();
+
+    /**
+     * Remove all checkpoint files
+     */
+    void removeCheckpoints() const;
+
+    /**
+     * Get the stream to which progress messages are written
+     * @return The log stream (std::cout by default)
+     */
+    std::ostream& getLog() const {
+        return *logStream;
+    }
+
+    /**
+     * Label the weakly connected components of a range of nodes
+     * @param myID Unique threadID
+     * @param numThreads Total number of threads
+     * @param parent Union-find forest over the node identifiers
+     */
+    void findComponentsThread(size_t myID, size_t numThreads,
+                              std::vector<std::atomic<NodeID> >* parent) const;
+
+    /**
+     * Group the weakly connected components into bundles of similar size
+     * @param bundles Identifiers of the nodes per bundle, larger first (output)
+     */
+    void createComponentBundles(std::vector<std::vector<NodeID> >& bundles) const;
+
+    /**
+     * Make this graph a copy of a set of closed components of another graph.
+     * The node sequences are shared with the other graph.
+     * @param src Graph to copy from
+     * @param nodeIDs Identifiers of the nodes to copy, in order
+     * @param localID Position (1-based) of every node in nodeIDs (indexed by src node ID)
+     */
+    void extractSubgraph(const DBGraph& src, const std::vector<NodeID>& nodeIDs,
+                         const std::vector<NodeID>& localID);
+
+    /**
+     * Replace the nodes of this graph by the valid nodes of subgraphs,
+     * in order of the subgraphs
+     * @param subgraphs Purified subgraphs
+     */
+    void stitchSubgraphs(const std::vector<DBGraph*>& subgraphs);
+
+    /**
+     * Purify bundles of components until none are left
+     * @param bundles Identifiers of the nodes per bundle
+     * @param localID Position of every node in its bundle
+     * @param nextBundle Index of the next bundle to purify
+     * @param subgraphs Purified subgraph per bundle (output)
+     * @param libraries Library container
+     */
+    void purifyBundlesThread(const std::vector<std::vector<NodeID> >* bundles,
+                             const std::vector<NodeID>* localID,
+                             std::atomic<size_t>* nextBundle,
+                             std::vector<DBGraph*>* subgraphs,
+                             const LibraryContainer* libraries);
+
+    /**
+     * Purify the weakly connected components of the graph in parallel.
+     * Every bundle of components is copied to a graph of its own and
+     * purified with the coverage parameters of the complete graph.
+     * @param libraries Library container
+     */
+    void componentPurification(const LibraryContainer& libraries);
 
 
 };
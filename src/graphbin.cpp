@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   Copyright (C) 2014, 2015 Jan Fostier (jan.fostier@intec.ugent.be)     *
+ *   Copyright (C) 2014, 2015 Mahdi Heydari (mahdi.heydari@intec.ugent.be) *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "graphbin.h"
+#include <fstream>
+#include <ios>
+#include <cstring>
+#include <cstddef>
+
+#ifndef _MSC_VER
+        #include <sys/mman.h>
+        #include <sys/stat.h>
+        #include <fcntl.h>
+        #include <unistd.h>
+#endif
+
+using namespace std;
+
+uint64_t graphBinChecksum(const void *data, size_t numBytes, uint64_t hash)
+{
+        const uint8_t *p = (const uint8_t*)data;
+        for (size_t i = 0; i < numBytes; i++) {
+                hash ^= p[i];
+                hash *= 1099511628211ull;
+        }
+
+        return hash;
+}
+
+uint64_t readGraphBinChecksum(const string& filename)
+{
+        ifstream ifs(filename.c_str(), ios::binary);
+        GraphBinHeader header;
+        if (!ifs.read((char*)&header, sizeof(header)))
+                return 0;
+        if (memcmp(header.magic, GRAPHBIN_MAGIC, sizeof(header.magic)) != 0)
+                return 0;
+        if (header.headerChecksum != graphBinChecksum(&header,
+                offsetof(GraphBinHeader, headerChecksum)))
+                return 0;
+
+        return header.headerChecksum;
+}
+
+void MappedFile::open(const string& filename)
+{
+        close();
+
+#ifndef _MSC_VER
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+                throw ios_base::failure("Can't open " + filename);
+
+        struct stat sb;
+        if (fstat(fd, &sb) != 0) {
+                ::close(fd);
+                throw ios_base::failure("Can't stat " + filename);
+        }
+
+        size = sb.st_size;
+        if (size > 0) {
+                void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE, fd, 0);
+                if (ptr != MAP_FAILED) {
+                        data = (uint8_t*)ptr;
+                        mapped = true;
+                }
+        }
+        ::close(fd);
+
+        if (mapped)
+                return;
+#endif
+        // fall back to reading the file into memory
+        ifstream ifs(filename.c_str(), ios::binary);
+        if (!ifs)
+                throw ios_base::failure("Can't open " + filename);
+
+        ifs.seekg(0, ios::end);
+        size = ifs.tellg();
+        ifs.seekg(0, ios::beg);
+
+        data = new uint8_t[size > 0 ? size : 1];
+        ifs.read((char*)data, size);
+        if (!ifs)
+                throw ios_base::failure("Can't read " + filename);
+        mapped = false;
+}
+
+void MappedFile::close()
+{
+        if (data == NULL)
+                return;
+#ifndef _MSC_VER
+        if (mapped)
+                munmap(data, size);
+        else
+                delete [] data;
+#else
+        delete [] data;
+#endif
+        data = NULL;
+        size = 0;
+        mapped = false;
+}
@@ -0,0 +1,213 @@
+/***************************************************************************
+ *   Copyright (C) 2014, 2015 Jan Fostier (jan.fostier@intec.ugent.be)     *
+ *   Copyright (C) 2014, 2015 Mahdi Heydari (mahdi.heydari@intec.ugent.be) *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef GRAPHBIN_H
+#define GRAPHBIN_H
+
+#include "global.h"
+#include <string>
+
+// ============================================================================
+// BINARY GRAPH FORMAT
+// ============================================================================
+
+// A binary graph file consists of a header, followed by the node records,
+// the arc records and a blob with the 2-bit packed node sequences. All
+// sections start at an 8-byte aligned offset.
+
+#define GRAPHBIN_MAGIC "BRWNGRPH"
+#define GRAPHBIN_VERSION 1
+
+struct GraphBinHeader {
+        char magic[8];                  // GRAPHBIN_MAGIC
+        uint32_t version;               // GRAPHBIN_VERSION
+        uint32_t kmerSize;              // kmer size used to build the graph
+        int64_t numNodes;               // number of nodes
+        int64_t numArcs;                // number of arcs
+        uint64_t nodeOffset;            // file offset of the node records
+        uint64_t arcOffset;             // file offset of the arc records
+        uint64_t seqOffset;             // file offset of the sequence blob
+        uint64_t seqSize;               // size of the sequence blob
+        uint64_t nodeChecksum;          // checksum of the node records
+        uint64_t arcChecksum;           // checksum of the arc records
+        uint64_t seqChecksum;           // checksum of the sequence blob
+        uint64_t headerChecksum;        // checksum of all fields above
+};
+
+struct GraphBinNode {
+        uint64_t seqOffset;             // offset of the sequence in the blob
+        double expMult;                 // expected multiplicity
+        uint32_t length;                // number of nucleotides
+        Coverage kmerCov;               // kmer coverage
+        Coverage readStartCov;          // read start coverage
+        ArcID leftID;                   // ID of the first left arc
+        ArcID rightID;                  // ID of the first right arc
+        uint8_t arcInfo;                // number of arcs, flags
+        uint8_t padding[3];
+};
+
+struct GraphBinArc {
+        NodeID nodeID;                  // target node identifier
+        Coverage coverage;              // arc coverage
+};
+
+static_assert(sizeof(GraphBinHeader) == 96, "Unexpected binary header size");
+static_assert(sizeof(GraphBinNode) == 40, "Unexpected binary node size");
+static_assert(sizeof(GraphBinArc) == 8, "Unexpected binary arc size");
+
+// A checkpoint of the graph purification consists of a binary graph file
+// and a state file. The state file holds the purification parameters and the
+// estimated node multiplicities, followed by a checksum of all preceding
+// bytes. It refers to its graph file and to the graph that was purified
+// through their header checksums.
+
+#define CHECKPOINT_MAGIC "BRWNCKPT"
+#define CHECKPOINT_VERSION 3
+
+// purification mode that wrote a checkpoint
+#define CHECKPOINT_MODE_GRAPH 0         // whole-graph purification
+#define CHECKPOINT_MODE_COMPONENT 1     // per-component purification
+
+struct CheckpointHeader {
+        char magic[8];                  // CHECKPOINT_MAGIC
+        uint32_t version;               // CHECKPOINT_VERSION
+        int32_t round;                  // last completed purification round
+        uint64_t sourceChecksum;        // header checksum of the input graph
+        uint64_t graphChecksum;         // header checksum of the graph file
+        double estimatedKmerCoverage;
+        double estimatedMKmerCoverageSTD;
+        double cutOffvalue;
+        double certainVlueCov;
+        double safeValueCov;
+        double redLineValueCov;
+        double readLength;
+        double readStartCovPerBase;
+        uint64_t maxNodeSizeToDel;
+        int32_t updateCutOffValueRound;
+        uint32_t purificationMode;      // CHECKPOINT_MODE_*
+        int64_t numMultRecords;         // number of multiplicity records
+};
+
+struct CheckpointMult {
+        int32_t multiplicity;           // estimated multiplicity
+        int32_t trueMultiplicity;       // true multiplicity (DEBUG, else 0)
+        double confidenceRatio;         // confidence in the estimate
+        double inCorrctnessRatio;       // likelihood of an erroneous node
+};
+
+static_assert(sizeof(CheckpointHeader) == 120, "Unexpected checkpoint header size");
+static_assert(sizeof(CheckpointMult) == 24, "Unexpected checkpoint record size");
+
+#define GRAPHBIN_CHECKSUM_SEED 14695981039346656037ull
+
+/**
+ * Compute the 64-bit FNV-1a checksum of a block of memory
+ * @param data Pointer to the data
+ * @param numBytes Number of bytes
+ * @param hash Checksum of the preceding data (to checksum in parts)
+ * @return The checksum
+ */
+uint64_t graphBinChecksum(const void *data, size_t numBytes,
+                          uint64_t hash = GRAPHBIN_CHECKSUM_SEED);
+
+/**
+ * Read the header checksum of a binary graph file
+ * @param filename Binary graph filename
+ * @return The header checksum (0 if the file has no valid header)
+ */
+uint64_t readGraphBinChecksum(const std::string& filename);
+
+// ============================================================================
+// MAPPED FILE CLASS
+// ============================================================================
+
+/**
+ * Read-only view of a file in memory. The file is memory-mapped privately:
+ * writes to the mapped memory are allowed but never reach the file. On
+ * platforms without mmap the file is read into a buffer instead.
+ */
+class MappedFile {
+
+private:
+        uint8_t *data;          // pointer to the file contents
+        size_t size;            // size of the file (in bytes)
+        bool mapped;            // true if data was obtained through mmap
+
+public:
+        /**
+         * Default constructor
+         */
+        MappedFile() : data(NULL), size(0), mapped(false) {}
+
+        /**
+         * Destructor
+         */
+        ~MappedFile() {
+                close();
+        }
+
+        /**
+         * Delete the copy constructor
+         */
+        MappedFile(const MappedFile&) = delete;
+
+        /**
+         * Delete the assignment operator
+         */
+        void operator=(const MappedFile&) = delete;
+
+        /**
+         * Map a file into memory
+         * @param filename Name of the file
+         */
+        void open(const std::string& filename);
+
+        /**
+         * Unmap the file
+         */
+        void close();
+
+        /**
+         * Check whether a file is mapped
+         * @return True or false
+         */
+        bool isOpen() const {
+                return data != NULL;
+        }
+
+        /**
+         * Get a pointer to the file contents
+         * @return A pointer to the file contents
+         */
+        uint8_t* getData() const {
+                return data;
+        }
+
+        /**
+         * Get the size of the file
+         * @return The size of the file (in bytes)
+         */
+        size_t getSize() const {
+                return size;
+        }
+};
+
+#endif
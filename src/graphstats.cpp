@@ -0,0 +1,133 @@
+/***************************************************************************
+ *   Copyright (C) 2014, 2015 Jan Fostier (jan.fostier@intec.ugent.be)     *
+ *   Copyright (C) 2014, 2015 Mahdi Heydari (mahdi.heydari@intec.ugent.be) *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "graphstats.h"
+#include <cassert>
+
+using namespace std;
+
+void GraphStatistics::reset(NodeID maxNodeID)
+{
+        lengthHist.clear();
+        covHist.clear();
+
+        present.assign(maxNodeID + 1, false);
+        nodeLength.assign(maxNodeID + 1, 0);
+        nodePos.assign(maxNodeID + 1, 0);
+        nodeCovBin.assign(maxNodeID + 1, 0);
+        nodeCorrect.assign(maxNodeID + 1, false);
+
+        numNodes = totalLength = 0;
+}
+
+void GraphStatistics::addNode(NodeID nodeID, size_t marginalLength,
+                              double nodeKmerCov, bool correct)
+{
+        assert(!contains(nodeID));
+
+        vector<NodeID>& bucket = lengthHist[marginalLength];
+        nodePos[nodeID] = bucket.size();
+        bucket.push_back(nodeID);
+        nodeLength[nodeID] = marginalLength;
+
+        size_t bin = (size_t)(nodeKmerCov / COVERAGE_BIN_WIDTH);
+        CoverageBin& covBin = covHist[bin];
+        covBin.numNodes++;
+        covBin.sumLength += marginalLength;
+        if (correct)
+                covBin.sumCorrectLength += marginalLength;
+        nodeCovBin[nodeID] = bin;
+        nodeCorrect[nodeID] = correct;
+
+        present[nodeID] = true;
+        numNodes++;
+        totalLength += marginalLength;
+}
+
+void GraphStatistics::removeNode(NodeID nodeID)
+{
+        assert(contains(nodeID));
+        size_t marginalLength = nodeLength[nodeID];
+
+        // move the last node of the bucket into the hole
+        map<size_t, vector<NodeID> >::iterator it = lengthHist.find(marginalLength);
+        vector<NodeID>& bucket = it->second;
+        NodeID lastID = bucket.back();
+        bucket[nodePos[nodeID]] = lastID;
+        nodePos[lastID] = nodePos[nodeID];
+        bucket.pop_back();
+        if (bucket.empty())
+                lengthHist.erase(it);
+
+        map<size_t, CoverageBin>::iterator covIt = covHist.find(nodeCovBin[nodeID]);
+        CoverageBin& covBin = covIt->second;
+        covBin.numNodes--;
+        covBin.sumLength -= marginalLength;
+        if (nodeCorrect[nodeID])
+                covBin.sumCorrectLength -= marginalLength;
+        if (covBin.numNodes == 0)
+                covHist.erase(covIt);
+
+        present[nodeID] = false;
+        numNodes--;
+        totalLength -= marginalLength;
+}
+
+size_t GraphStatistics::getN50(size_t overlap) const
+{
+        size_t totalNodeLength = totalLength + numNodes * overlap;
+
+        size_t currLength = 0;
+        for (map<size_t, vector<NodeID> >::const_iterator it = lengthHist.begin();
+             it != lengthHist.end(); it++) {
+                size_t length = it->first + overlap;
+                currLength += it->second.size() * length;
+                if (currLength >= 0.5 * totalNodeLength)
+                        return length;
+        }
+
+        return 0;
+}
+
+size_t GraphStatistics::getMaxLength(size_t overlap) const
+{
+        if (lengthHist.empty())
+                return 0;
+        return lengthHist.rbegin()->first + overlap;
+}
+
+void GraphStatistics::getLongestNodes(double minTotalLength,
+                                      vector<NodeID>& nodeIDs) const
+{
+        nodeIDs.clear();
+
+        double currLength = 0;
+        for (map<size_t, vector<NodeID> >::const_reverse_iterator it = lengthHist.rbegin();
+             it != lengthHist.rend() && it->first > 0; it++) {
+                const vector<NodeID>& bucket = it->second;
+                for (size_t i = 0; i < bucket.size(); i++) {
+                        if (currLength >= minTotalLength)
+                                return;
+                        nodeIDs.push_back(bucket[i]);
+                        currLength += it->first;
+                }
+        }
+}
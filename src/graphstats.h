@@ -0,0 +1,151 @@
+/***************************************************************************
+ *   Copyright (C) 2014, 2015 Jan Fostier (jan.fostier@intec.ugent.be)     *
+ *   Copyright (C) 2014, 2015 Mahdi Heydari (mahdi.heydari@intec.ugent.be) *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef GRAPHSTATS_H
+#define GRAPHSTATS_H
+
+#include "global.h"
+#include <vector>
+#include <map>
+
+// ============================================================================
+// GRAPH STATISTICS CLASS
+// ============================================================================
+
+/**
+ * Node statistics that are kept up to date while nodes are removed and
+ * merged: a histogram of the marginal node lengths (with the nodes per
+ * length), a histogram of the node k-mer coverage and running sums. Queries
+ * only visit the histogram buckets instead of sorting all nodes.
+ */
+class GraphStatistics {
+
+public:
+        /**
+         * Bin of the node k-mer coverage histogram
+         */
+        struct CoverageBin {
+                size_t numNodes;        // number of nodes in the bin
+                size_t sumLength;       // sum of their marginal lengths
+                size_t sumCorrectLength;// idem, for nodes marked as correct
+
+                CoverageBin() : numNodes(0), sumLength(0), sumCorrectLength(0) {}
+        };
+
+private:
+        std::map<size_t, std::vector<NodeID> > lengthHist;      // nodes per marginal length
+        std::map<size_t, CoverageBin> covHist;                  // nodes per coverage bin
+
+        std::vector<bool> present;              // true if a node is counted
+        std::vector<NodeLength> nodeLength;     // marginal length of a node
+        std::vector<uint32_t> nodePos;          // position in its length bucket
+        std::vector<uint32_t> nodeCovBin;       // coverage bin of a node
+        std::vector<bool> nodeCorrect;          // true if marked as correct
+
+        size_t numNodes;                        // number of nodes counted
+        size_t totalLength;                     // sum of the marginal lengths
+
+public:
+        /**
+         * Default constructor
+         */
+        GraphStatistics() : numNodes(0), totalLength(0) {}
+
+        /**
+         * Remove all nodes and make room for a number of node identifiers
+         * @param maxNodeID Largest node identifier
+         */
+        void reset(NodeID maxNodeID);
+
+        /**
+         * Count a node
+         * @param nodeID Identifier of the node (positive)
+         * @param marginalLength Marginal length of the node
+         * @param nodeKmerCov Average k-mer coverage of the node
+         * @param correct True if the node is known to be correct
+         */
+        void addNode(NodeID nodeID, size_t marginalLength,
+                     double nodeKmerCov, bool correct = false);
+
+        /**
+         * Stop counting a node, the values it was added with are removed
+         * @param nodeID Identifier of the node (positive)
+         */
+        void removeNode(NodeID nodeID);
+
+        /**
+         * Check whether a node is counted
+         * @param nodeID Identifier of the node (positive)
+         * @return True or false
+         */
+        bool contains(NodeID nodeID) const {
+                return nodeID < (NodeID)present.size() && present[nodeID];
+        }
+
+        /**
+         * Get the number of nodes counted
+         * @return The number of nodes
+         */
+        size_t getNumNodes() const {
+                return numNodes;
+        }
+
+        /**
+         * Get the sum of the marginal lengths of all nodes
+         * @return The total marginal length
+         */
+        size_t getTotalMarginalLength() const {
+                return totalLength;
+        }
+
+        /**
+         * Get the N50 of the node lengths, counted from the shortest node
+         * @param overlap Difference between node and marginal length
+         * @return Length of the node that contains the median nucleotide
+         */
+        size_t getN50(size_t overlap) const;
+
+        /**
+         * Get the length of the longest node
+         * @param overlap Difference between node and marginal length
+         * @return The length of the longest node (0 if there are none)
+         */
+        size_t getMaxLength(size_t overlap) const;
+
+        /**
+         * Get the longest nodes, in order of decreasing marginal length, until
+         * their marginal lengths sum up to a certain value
+         * @param minTotalLength Minimum sum of the marginal lengths
+         * @param nodeIDs Identifiers of the longest nodes (output)
+         */
+        void getLongestNodes(double minTotalLength,
+                             std::vector<NodeID>& nodeIDs) const;
+
+        /**
+         * Get the coverage histogram
+         * @return Bins indexed by node k-mer coverage / COVERAGE_BIN_WIDTH
+         */
+        const std::map<size_t, CoverageBin>& getCoverageHistogram() const {
+                return covHist;
+        }
+};
+
+#endif
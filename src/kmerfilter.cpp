@@ -0,0 +1,43 @@
+/***************************************************************************
+ *   Copyright (C) 2015-2016 Jan Fostier (jan.fostier@intec.ugent.be)      *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "kmerfilter.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// ============================================================================
+// KMER FILTER CLASS
+// ============================================================================
+
+const uint32_t KmerFilter::salt[8] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+
+void KmerFilter::init(size_t numKmers)
+{
+        numBlocks = max<size_t>(1, (numKmers * KMER_FILTER_BITS_PER_KMER + 511) / 512);
+
+        // seven extra words to align the first block to 64 bytes
+        buffer.assign(8 * numBlocks + 7, 0);
+        uintptr_t first = ((uintptr_t)buffer.data() + 63) & ~(uintptr_t)63;
+        blocks = (uint64_t*)first;
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2015-2016 Jan Fostier (jan.fostier@intec.ugent.be)      *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef KMERFILTER_H
+#define KMERFILTER_H
+
+#include "global.h"
+#include "tkmer.h"
+
+#include <vector>
+#include <stdint.h>
+
+// ============================================================================
+// KMER FILTER CLASS
+// ============================================================================
+
+/**
+ * Blocked Bloom filter over a set of kmers. A kmer sets one bit in each of
+ * the eight 64-bit words of a 64-byte block, so a lookup touches a single
+ * cache line. A kmer that was inserted is always found; a kmer that was not
+ * inserted is found with a small probability (about 0.4% at
+ * KMER_FILTER_BITS_PER_KMER = 12).
+ */
+class KmerFilter {
+
+private:
+        __extension__ typedef unsigned __int128 uint128_t;      // GCC/Clang
+
+        static const uint32_t salt[8];  // one multiplier per word of a block
+
+        std::vector<uint64_t> buffer;   // storage of the blocks
+        uint64_t *blocks;               // first block (64-byte aligned)
+        size_t numBlocks;               // number of blocks
+
+        /**
+         * Get the block of a hash value
+         * @param hash Hash value of a kmer
+         * @return Pointer to the first word of the block
+         */
+        uint64_t* getBlock(uint64_t hash) const {
+                return blocks + 8 * (size_t)(((uint128_t)hash * numBlocks) >> 64);
+        }
+
+        /**
+         * Get the bit of a hash value in a word of its block
+         * @param hash Hash value of a kmer
+         * @param word Word of the block (0 to 7)
+         * @return Mask with a single bit set
+         */
+        static uint64_t getMask(uint64_t hash, int word) {
+                return 1ull << (((uint32_t)hash * salt[word]) >> 26);
+        }
+
+public:
+        /**
+         * Default constructor (empty filter that contains nothing)
+         */
+        KmerFilter() : blocks(NULL), numBlocks(0) {}
+
+        /**
+         * Deleted copy constructor (blocks points into the buffer)
+         */
+        KmerFilter(const KmerFilter&) = delete;
+
+        /**
+         * Deleted assignment operator (blocks points into the buffer)
+         */
+        KmerFilter& operator=(const KmerFilter&) = delete;
+
+        /**
+         * Clear the filter and size it for a number of kmers
+         * @param numKmers Number of kmers that will be inserted
+         */
+        void init(size_t numKmers);
+
+        /**
+         * Insert a kmer
+         * @param kmer Kmer to insert
+         */
+        void insert(const Kmer& kmer) {
+                uint64_t hash = kmer.getHash();
+                uint64_t *block = getBlock(hash);
+                for (int w = 0; w < 8; w++)
+                        block[w] |= getMask(hash, w);
+        }
+
+        /**
+         * Check whether a kmer may have been inserted
+         * @param kmer Kmer to check
+         * @return False if the kmer was certainly not inserted
+         */
+        bool contains(const Kmer& kmer) const {
+                if (numBlocks == 0)
+                        return false;
+
+                uint64_t hash = kmer.getHash();
+                const uint64_t *block = getBlock(hash);
+                uint64_t missing = 0;
+                for (int w = 0; w < 8; w++)
+                        missing |= getMask(hash, w) & ~block[w];
+                return missing == 0;
+        }
+
+        /**
+         * Get the size of the filter
+         * @return The size of the filter in bytes
+         */
+        size_t getNumBytes() const {
+                return numBlocks * 8 * sizeof(uint64_t);
+        }
+};
+
+#endif
@@ -179,6 +179,17 @@ public:
                 complement(str);
         }
 
+        /**
+         * Reverse complement a range of characters in place
+         * @param str First character of the range (input/output)
+         * @param len Number of characters in the range
+         */
+        static void revCompl(char *str, size_t len) {
+                std::reverse(str, str + len);
+                for (size_t i = 0; i < len; i++)
+                        str[i] = getComplement(str[i]);
+        }
+
         /**
          * Get reverse of an stl string
          * @param str The string to be reversed
@@ -21,6 +21,8 @@
 #include <thread>
 #include <string>
 #include <iomanip>
+#include <fstream>
+#include <cstdio>
 
 #include "library.h"
 #include "readcorrection.h"
@@ -37,14 +39,18 @@ void AlignmentMetrics::addMetrics(const AlignmentMetrics& rhs)
         lock_guard<mutex> lock(metricMutex);
         numReads += rhs.numReads;
         numCorrReads += rhs.numCorrReads;
+        numVerifiedReads += rhs.numVerifiedReads;
         numCorrByMEM += rhs.numCorrByMEM;
         numSubstitutions += rhs.numSubstitutions;
+        numSearches += rhs.numSearches;
+        numSearchLimitHits += rhs.numSearchLimitHits;
+        numPrunedStates += rhs.numPrunedStates;
 }
 
 void AlignmentMetrics::printStatistics() const
 {
         size_t numCorrByKmer = numCorrReads - numCorrByMEM;
-        size_t numUncorrected = numReads - numCorrReads;
+        size_t numUncorrected = numReads - numCorrReads - numVerifiedReads;
 
         cout << "\nError correction report:\n";
         cout << "\tNumber of reads handled: " << numReads << endl;
@@ -60,24 +66,34 @@ void AlignmentMetrics::printStatistics() const
         cout << "\tNumber of substitutions in reads: " << numSubstitutions
              << fixed << setprecision(2) << " (avg of "
              << double(numSubstitutions)/double(numReads) << " per read)" << endl;
+        cout << "\tNumber of reads that agree with the graph: " << numVerifiedReads
+             << fixed << setprecision(2) << " ("
+             << Util::toPercentage(numVerifiedReads, numReads) << "%)" << endl;
         cout << "\tNumber of uncorrected reads: " << numUncorrected
              << fixed << setprecision(2) << " ("
              << Util::toPercentage(numUncorrected, numReads) << "%)" << endl;
+        cout << "\tNumber of graph searches that hit the node limit: "
+             << numSearchLimitHits << fixed << setprecision(2) << " ("
+             << Util::toPercentage(numSearchLimitHits, numSearches) << "%)" << endl;
+        cout << "\tNumber of pruned revisits of graph search states: "
+             << numPrunedStates << endl;
 }
 
 // ============================================================================
 // SEED CLASS
 // ============================================================================
 
-void Seed::createNodePosition(const DBGraph& dbg, vector<NodePosPair>& npp) const
+void Seed::createNodePosition(const DBGraph& dbg,
+                              const vector<NodeID>& chainPool,
+                              vector<NodePosPair>& npp) const
 {
         size_t currReadPos = readFirst;
-        for (vector<NodeID>::const_iterator it = nodeID.begin(); it != nodeID.end(); it++) {
-                SSNode node = dbg.getSSNode(*it);
-                size_t nodeOffset = (it == nodeID.begin()) ? nodeFirst : 0;
+        for (size_t c = chainFirst; c < chainEnd; c++) {
+                SSNode node = dbg.getSSNode(chainPool[c]);
+                size_t nodeOffset = (c == chainFirst) ? nodeFirst : 0;
                 size_t nodeOL = min(node.getMarginalLength() - nodeOffset, readEnd - currReadPos);
                 for (size_t i = 0; i < nodeOL; i++)
-                        npp[currReadPos+i] = NodePosPair(*it, i + nodeOffset);
+                        npp[currReadPos+i] = NodePosPair(chainPool[c], i + nodeOffset);
                 currReadPos += nodeOL;
         }
 }
@@ -96,8 +112,8 @@ void Seed::mergeSeeds(const vector<Seed>& seeds,
                 const Seed& right = seeds[i];
 
                 bool consistent = false;
-                if (left.nodeID.size() == 1 && right.nodeID.size() == 1)
-                        if (left.nodeID.front() == right.nodeID.front())
+                if (left.getChainLength() == 1 && right.getChainLength() == 1)
+                        if (left.nodeID == right.nodeID)
                                 if ((right.nodeFirst - left.nodeFirst) == (right.readFirst - left.readFirst))
                                         consistent = true;
 
@@ -108,6 +124,72 @@ void Seed::mergeSeeds(const vector<Seed>& seeds,
         }
 }
 
+// ============================================================================
+// SEARCH STATE TABLE CLASS
+// ============================================================================
+
+void SearchStateTable::grow()
+{
+        size_t numSlots = 2 * state.size();
+        vector<uint64_t> newState(numSlots);
+        vector<int> newScore(numSlots);
+        vector<uint32_t> newStamp(numSlots, 0);
+        shift--;
+
+        for (size_t i = 0; i < state.size(); i++) {
+                if (stamp[i] != currStamp)
+                        continue;
+
+                size_t slot = getSlot(state[i]);
+                while (newStamp[slot] == currStamp)
+                        slot = (slot + 1) & (numSlots - 1);
+
+                newState[slot] = state[i];
+                newScore[slot] = score[i];
+                newStamp[slot] = currStamp;
+        }
+
+        state.swap(newState);
+        score.swap(newScore);
+        stamp.swap(newStamp);
+}
+
+void SearchStateTable::clear()
+{
+        numStates = 0;
+        currStamp++;
+
+        // the stamps have wrapped around: clear the slots for real
+        if (currStamp == 0) {
+                fill(stamp.begin(), stamp.end(), 0);
+                currStamp = 1;
+        }
+}
+
+bool SearchStateTable::update(uint64_t s, int newScore)
+{
+        size_t slot = getSlot(s);
+        while (stamp[slot] == currStamp) {
+                if (state[slot] == s) {
+                        if (score[slot] >= newScore)
+                                return false;
+                        score[slot] = newScore;
+                        return true;
+                }
+                slot = (slot + 1) & (state.size() - 1);
+        }
+
+        state[slot] = s;
+        score[slot] = newScore;
+        stamp[slot] = currStamp;
+
+        // keep the load factor below one half
+        if (++numStates * 2 > state.size())
+                grow();
+
+        return true;
+}
+
 // ============================================================================
 // READ CORRECTION CLASS
 // ============================================================================
@@ -140,6 +222,13 @@ void ReadCorrection::findNPPFast(const string& read, vector<NodePosPair>& nppv)
 {
         for (KmerIt it(read); it.isValid(); it++) {
                 Kmer kmer = it.getKmer();
+
+                // kmers rejected by the filter are not in the graph
+                if (!kmerFilter.contains(kmer)) {
+                        nppv[it.getOffset()] = NodePosPair();
+                        continue;
+                }
+
                 NodePosPair npp = dbg.getNodePosPair(kmer);
                 nppv[it.getOffset()] = npp;
 
@@ -176,7 +265,9 @@ void ReadCorrection::extractSeeds(const vector<NodePosPair>& nppv,
                 // is it the first time we encounter a valid npp?
                 if (prev == nppv.size()) {
                         prev = i;
-                        seeds.push_back(Seed(nppv[i].getNodeID(), nppv[i].getOffset(), i, i + 1));
+                        ws.chainPool.push_back(nppv[i].getNodeID());
+                        seeds.push_back(Seed(nppv[i].getNodeID(), ws.chainPool.size() - 1,
+                                             nppv[i].getOffset(), i, i + 1));
                         continue;
                 }
 
@@ -192,7 +283,9 @@ void ReadCorrection::extractSeeds(const vector<NodePosPair>& nppv,
                         if (prevNode.getRightArc(thisNode.getNodeID()) != NULL) {
                                 size_t thisPos = prevNode.getMarginalLength() + nppv[i].getOffset();
                                 if ((thisPos - nppv[prev].getOffset()) == (i - prev)) {
-                                        seeds.back().nodeID.push_back(thisNode.getNodeID());
+                                        // the chain of the last seed ends the pool
+                                        ws.chainPool.push_back(thisNode.getNodeID());
+                                        seeds.back().chainEnd++;
                                         consistent = true;
                                 }
                         }
@@ -200,7 +293,9 @@ void ReadCorrection::extractSeeds(const vector<NodePosPair>& nppv,
 
                 prev = i;
                 if (!consistent) {
-                        seeds.push_back(Seed(nppv[i].getNodeID(), nppv[i].getOffset(), i, i + 1));
+                        ws.chainPool.push_back(nppv[i].getNodeID());
+                        seeds.push_back(Seed(nppv[i].getNodeID(), ws.chainPool.size() - 1,
+                                             nppv[i].getOffset(), i, i + 1));
                 } else {
                         seeds.back().readEnd = i + 1;
                 }
@@ -209,36 +304,67 @@ void ReadCorrection::extractSeeds(const vector<NodePosPair>& nppv,
 
 void ReadCorrection::recSearch(NodeID curr, string& read, vector<NodePosPair>& npp,
                                   size_t currReadPos, size_t& counter,
-                                  int currScore, int& bestScore, size_t& seedLast)
+                                  int currScore, int& bestScore, size_t& seedLast,
+                                  size_t depth)
 {
+        // a state reached before with at least the same score cannot
+        // improve the best score: its subtree has been searched already
+        uint64_t state = ((uint64_t)(uint32_t)curr << 32) | currReadPos;
+        if (!ws.searchStates.update(state, currScore)) {
+                numPrunedStates++;
+                return;
+        }
+
         const SSNode node = dbg.getSSNode(curr);
 
         counter++;
         if (counter > settings.getReadCorrDFSNodeLimit())
                 return;
 
-        vector<DFSNode> dfsNode;
-
         size_t readCharLeft = getMarginalLength(read) - currReadPos;
 
+        // the overlaps of the children are copied back to back in nodeOL
+        ws.nextIDs.clear();
+        ws.nodeOL.clear();
+        ws.nodeOLFirst.assign(1, 0);
         for (ArcIt it = node.rightBegin(); it != node.rightEnd(); it++) {
-                NodeID nextID = it->getNodeID();
+                const SSNode nextNode = dbg.getSSNode(it->getNodeID());
+                size_t OLSize = min(nextNode.getMarginalLength(), readCharLeft);
+
+                size_t OLFirst = ws.nodeOL.size();
+                ws.nodeOL.resize(OLFirst + OLSize);
+                nextNode.copySubstr(Kmer::getK()-1, OLSize, &ws.nodeOL[OLFirst]);
+
+                ws.nextIDs.push_back(it->getNodeID());
+                ws.nodeOLFirst.push_back(ws.nodeOL.size());
+        }
+
+        // all children are aligned against the same read window at once
+        alignment.alignBatch(read, currReadPos + Kmer::getK() - 1,
+                             ws.nodeOL, ws.nodeOLFirst, ws.OLScore);
+
+        // the children are kept per depth, the other buffers are reused by
+        // the deeper levels of the search
+        if (ws.dfsStack.size() <= depth)
+                ws.dfsStack.resize(depth + 1);
+        vector<DFSNode>& dfsNode = ws.dfsStack[depth];
+        dfsNode.clear();
+
+        for (size_t i = 0; i < ws.nextIDs.size(); i++) {
+                NodeID nextID = ws.nextIDs[i];
                 const SSNode nextNode = dbg.getSSNode(nextID);
 
-                size_t OLSize = min(nextNode.getMarginalLength(), readCharLeft);
+                size_t OLSize = ws.nodeOLFirst[i+1] - ws.nodeOLFirst[i];
                 size_t nextReadPos = currReadPos + OLSize;
 
-                string nodeOL = nextNode.substr(Kmer::getK()-1, OLSize);
-                string readOL = read.substr(currReadPos + Kmer::getK() - 1, OLSize);
-
-                int thisScore = alignment.align(readOL, nodeOL);
+                int thisScore = ws.OLScore[i];
                 int nextScore = currScore + thisScore;
                 float nextRelScore = (float)thisScore / (float)nextNode.getMarginalLength();
 
                 dfsNode.push_back(DFSNode(nextID, nextReadPos, nextScore, nextRelScore));
 
                 // =====================
-                /*string str = nextNode.substr(Kmer::getK()-1, OLSize);
+                /*string str = ws.nodeOL.substr(ws.nodeOLFirst[i], OLSize);
                 string readSubStr = read.substr(currReadPos + Kmer::getK() -1, OLSize);
 
                 for (size_t i = 0; i < currReadPos + Kmer::getK() - 1; i++)
@@ -249,7 +375,9 @@ void ReadCorrection::recSearch(NodeID curr, string& read, vector<NodePosPair>& n
 
         sort(dfsNode.begin(), dfsNode.end());
 
-        for (auto& it : dfsNode) {
+        // the stack may be reallocated by the deeper levels: use an index
+        for (size_t c = 0; c < ws.dfsStack[depth].size(); c++) {
+                const DFSNode it = ws.dfsStack[depth][c];
                 NodeID nextID = it.nodeID;
                 int nextScore = it.score;
                 size_t nextReadPos = it.readPos;
@@ -274,7 +402,8 @@ void ReadCorrection::recSearch(NodeID curr, string& read, vector<NodePosPair>& n
 
                 // descend in a child node only if there is chance this will improve the best score
                 if (maxAttainScore > bestScore)
-                        recSearch(nextID, read, npp, nextReadPos, counter, nextScore, bestScore, seedLast);
+                        recSearch(nextID, read, npp, nextReadPos, counter,
+                                  nextScore, bestScore, seedLast, depth + 1);
 
                 // if the best score has been updated in this branch...
                 if (bestScore <= prevBestScore)
@@ -313,8 +442,14 @@ void ReadCorrection::extendSeed(string& read, vector<NodePosPair>& npp,
         //if (seedLast < getMarginalLength(read))
         //      cout << read << endl;
         size_t counter = 0; int bestScore = -(getMarginalLength(read) - seedLast);
-        if (seedLast < getMarginalLength(read))
+        if (seedLast < getMarginalLength(read)) {
+                ws.searchStates.clear();
                 recSearch(node.getNodeID(), read, npp, seedLast, counter, 0, bestScore, seedLast);
+
+                numSearches++;
+                if (counter > (size_t)settings.getReadCorrDFSNodeLimit())
+                        numSearchLimitHits++;
+        }
 }
 
 void ReadCorrection::applyReadCorrection(string& read,
@@ -326,14 +461,13 @@ void ReadCorrection::applyReadCorrection(string& read,
         while (curr < seedLast) {
                 SSNode node = dbg.getSSNode(npp[curr].getNodeID());
                 size_t strLen = min(node.getLength() - npp[curr].getOffset(), read.size() - curr);
-                string str = node.substr(npp[curr].getOffset(), strLen);
+                node.copySubstr(npp[curr].getOffset(), strLen, &read[curr]);
 
-                read.replace(curr, strLen, str);
                 curr += (strLen - Kmer::getK() + 1);
         }
 }
 
-void ReadCorrection::correctRead(string& read, vector<NodePosPair> npp,
+void ReadCorrection::correctRead(string& read, vector<NodePosPair>& npp,
                                     size_t& first, size_t& last)
 {
         // extend to the right
@@ -355,23 +489,35 @@ void ReadCorrection::correctRead(string& read, vector<NodePosPair> npp,
         swap(first, last);
         revCompl(npp);
 
-        // reverse complement all data
-        string original = read;
         applyReadCorrection(read, npp, first, last);
 }
 
-void ReadCorrection::findSeedKmer(const std::string& read,
+bool ReadCorrection::findSeedKmer(const std::string& read,
                                      vector<Seed>& mergedSeeds)
 {
-        vector<NodePosPair> nppv(read.length() + 1 - Kmer::getK());
+        vector<NodePosPair>& nppv = ws.nppv;
+        nppv.assign(read.length() + 1 - Kmer::getK(), NodePosPair());
 
         // find the node position pairs using the kmer lookup table
         findNPPFast(read, nppv);
 
         // transform consistent npps to seeds
-        vector<Seed> seeds;
+        vector<Seed>& seeds = ws.seeds;
+        seeds.clear();
         extractSeeds(nppv, seeds);
 
+        // a single seed that covers all kmers: the read is a path in the
+        // graph (a seed may span kmers that were not found, e.g. around a
+        // substitution, so each kmer is checked as well)
+        if (seeds.size() == 1 && seeds.front().readFirst == 0 &&
+            seeds.front().readEnd == nppv.size()) {
+                size_t numFound = 0;
+                while (numFound < nppv.size() && nppv[numFound].isValid())
+                        numFound++;
+                if (numFound == nppv.size())
+                        return true;
+        }
+
         // sort seeds according to nodeID
         sort(seeds.begin(), seeds.end());
 
@@ -405,6 +551,8 @@ void ReadCorrection::findSeedKmer(const std::string& read,
                 cout << endl;
         }*/
         // ----------- OUTPUT ------------
+
+        return false;
 }
 
 bool sortByLength(const Seed& a, const Seed& b) {
@@ -414,7 +562,8 @@ bool sortByLength(const Seed& a, const Seed& b) {
 void ReadCorrection::findSeedMEM(const string& read,
                                     vector<Seed>& mergedSeeds)
 {
-        vector<match_t> matches;
+        vector<match_t>& matches = ws.matches;
+        matches.clear();
 
         int memSize = Kmer::getK() - 1;
         while (matches.size() < 100 && memSize>5) {
@@ -426,8 +575,8 @@ void ReadCorrection::findSeedMEM(const string& read,
         }
 
 
-        vector<Seed> seeds;
-        seeds.reserve(matches.size());
+        vector<Seed>& seeds = ws.seeds;
+        seeds.clear();
         for (auto it : matches) {
 
                 vector<long>::const_iterator e = upper_bound(startpos.begin(), startpos.end(), it.ref);
@@ -455,7 +604,9 @@ void ReadCorrection::findSeedMEM(const string& read,
 
                 size_t readEnd = readFirst + it.len; //(it.len > Kmer::getK() ? it.len +1 - Kmer::getK() : 1);
 
-                seeds.push_back(Seed(nodeID, nodeFirst, readFirst, readEnd));
+                ws.chainPool.push_back(nodeID);
+                seeds.push_back(Seed(nodeID, ws.chainPool.size() - 1,
+                                     nodeFirst, readFirst, readEnd));
         }
 
         // sort seeds according to nodeID
@@ -505,23 +656,25 @@ int ReadCorrection::correctRead(const string& read,
                 size_t last = it.readEnd;
 
                 // create a npp vector
-                vector<NodePosPair> npp(read.length() + 1 - Kmer::getK());
-                it.createNodePosition(dbg, npp);
+                vector<NodePosPair>& npp = ws.npp;
+                npp.assign(read.length() + 1 - Kmer::getK(), NodePosPair());
+                it.createNodePosition(dbg, ws.chainPool, npp);
 
-                string correctedRead = read;
+                string& correctedRead = ws.correctedRead;
+                correctedRead = read;
                 correctRead(correctedRead, npp, first, last);
 
                 size_t correctedLength = Kmer::getK() - 1 + last - first;
                 size_t uncorrectedLength = read.size() - correctedLength;
 
-                int score = alignment.align(read, correctedRead) - uncorrectedLength;
+                int score = alignment.alignScore(read, correctedRead) - uncorrectedLength;
 
                 /*cout << "Seed: " << first << " to " << last << endl;
                 alignment.printAlignment(read, correctedRead);
                 cout << "Score: " << score << endl;*/
 
                 if (score > bestScore) {
-                        bestCorrectedRead = correctedRead;
+                        bestCorrectedRead.swap(correctedRead);
                         bestScore = score;
                 }
         }
@@ -539,10 +692,18 @@ void ReadCorrection::correctRead(ReadRecord& record,
         if (read.length() < Kmer::getK())
                 return;
 
-        vector<Seed> seeds;
-        findSeedKmer(read, seeds);
+        // the seeds of both procedures share the node pool
+        vector<Seed>& seeds = ws.mergedSeeds;
+        seeds.clear();
+        ws.chainPool.clear();
+        // reads that agree with the graph need no search nor alignment
+        if (findSeedKmer(read, seeds)) {
+                metrics.addVerifiedObservation();
+                return;
+        }
 
-        string bestCorrectedRead;
+        string& bestCorrectedRead = ws.bestCorrectedRead;
+        bestCorrectedRead.clear();
         int bestScore = correctRead(read, bestCorrectedRead, seeds);
 
         if (bestScore <= ((int)read.size() / 2)) {
@@ -563,6 +724,8 @@ void ReadCorrection::correctRead(ReadRecord& record,
         }
 
         metrics.addObservation(readCorrected, correctedByMEM, numSubstitutions);
+        metrics.addSearchObservations(numSearches, numSearchLimitHits, numPrunedStates);
+        numSearches = numSearchLimitHits = numPrunedStates = 0;
 }
 
 void ReadCorrection::correctChunk(vector<ReadRecord>& readChunk,
@@ -584,7 +747,8 @@ void ReadCorrection::correctChunk(vector<ReadRecord>& readChunk,
 void ReadCorrectionHandler::workerThread(size_t myID, LibraryContainer& libraries,
                                          AlignmentMetrics& metrics)
 {
-        ReadCorrection readCorrection(dbg, settings, *sa, startpos);
+        dbg.activate();
+        ReadCorrection readCorrection(dbg, settings, *sa, startpos, kmerFilter);
 
         // local storage of reads
         vector<ReadRecord> myReadBuf;
@@ -608,6 +772,37 @@ void ReadCorrectionHandler::workerThread(size_t myID, LibraryContainer& librarie
         metrics.addMetrics(threadMetrics);
 }
 
+void ReadCorrectionHandler::initKmerFilter()
+{
+        // the reverse complements are inserted as well, so that the kmers
+        // of a read can be checked without computing their representative
+        size_t numKmers = 0;
+        for (NodeID id = 1; id <= dbg.getNumNodes(); id++) {
+                const DSNode& node = dbg.getDSNode(id);
+                if (node.isValid())
+                        numKmers += node.getMarginalLength();
+        }
+
+        bool doubleStranded = settings.isDoubleStranded();
+        kmerFilter.init(doubleStranded ? 2 * numKmers : numKmers);
+
+        for (NodeID id = 1; id <= dbg.getNumNodes(); id++) {
+                const DSNode& node = dbg.getDSNode(id);
+                if (!node.isValid())
+                        continue;
+
+                const TString& tStr = node.getTSequence();
+                Kmer kmer(tStr);
+                for (size_t i = Kmer::getK(); i <= tStr.getLength(); i++) {
+                        kmerFilter.insert(kmer);
+                        if (doubleStranded)
+                                kmerFilter.insert(kmer.getReverseComplement());
+                        if (i < tStr.getLength())
+                                kmer.pushNucleotideRight(tStr[i]);
+                }
+        }
+}
+
 void ReadCorrectionHandler::initEssaMEM()
 {
         size_t length = 0;
@@ -620,20 +815,15 @@ void ReadCorrectionHandler::initEssaMEM()
                 length += node.getLength() * 2 + 2;
         }
 
-        reference.clear();
-        reference.reserve(length);
+        // each node adds its sequence and reverse complement, separated
+        // by '>'; the reverse complement is not stored explicitly
+        reference = packed_text();
         for (NodeID nodeID = 1; nodeID < dbg.getNumNodes(); nodeID++) {
                 SSNode node = dbg.getSSNode(nodeID);
                 if (!node.isValid())
                         continue;
 
-                string thisSequence = node.getSequence();
-                reference.append(thisSequence);
-                reference.append(">");
-
-                Nucleotide::revCompl(thisSequence);
-                reference.append(thisSequence);
-                reference.append(">");
+                reference.append(node.getSequence());
         }
 
         std::vector<std::string> refdescr;
@@ -656,7 +846,60 @@ void ReadCorrectionHandler::initEssaMEM()
                           printRevCompForw,
                           false                                 // nucleotides only
                           );
-        sa->construct();
+
+        // the padded reference and the sparseness factor identify the index
+        long sparseness = settings.getEssaMEMSparsenessFactor();
+        uint64_t key = graphBinChecksum(reference.bases.data(),
+                                        reference.bases.size() * sizeof(uint64_t));
+        key = graphBinChecksum(reference.recStart.data(),
+                               reference.recStart.size() * sizeof(long), key);
+        key = graphBinChecksum(&reference.padLen, sizeof(reference.padLen), key);
+        key = graphBinChecksum(&sparseness, sizeof(sparseness), key);
+
+        if (loadEssaMEMCache(key))
+                return;
+
+        sa->construct(settings.getNumThreads());
+        saveEssaMEMCache(key);
+}
+
+bool ReadCorrectionHandler::loadEssaMEMCache(uint64_t key)
+{
+        string prefix = getEssaMEMCachePrefix();
+        ifstream ifs((prefix + ".key").c_str());
+        int cacheVersion;
+        uint64_t cacheKey;
+        long cacheN;
+        if (!(ifs >> cacheVersion >> cacheKey >> cacheN))
+                return false;
+        if (cacheVersion != ESSAMEM_CACHE_VERSION)
+                return false;
+        if (cacheKey != key || cacheN != sa->N)
+                return false;
+
+        // a failed load leaves the index unchanged, ready to be constructed
+        return sa->load(prefix);
+}
+
+void ReadCorrectionHandler::saveEssaMEMCache(uint64_t key)
+{
+        // the key file is written last: it marks the index as complete
+        string prefix = getEssaMEMCachePrefix();
+        remove((prefix + ".key").c_str());
+        if (!sa->save(prefix)) {
+                cerr << "Could not write the essaMEM index cache" << endl;
+                return;
+        }
+
+        ofstream ofs((prefix + ".key.tmp").c_str());
+        ofs << ESSAMEM_CACHE_VERSION << "\t" << key << "\t" << sa->N << "\n";
+        ofs.close();
+        if (!ofs) {
+                cerr << "Could not write the essaMEM index cache" << endl;
+                return;
+        }
+
+        rename((prefix + ".key.tmp").c_str(), (prefix + ".key").c_str());
 }
 
 void ReadCorrectionHandler::doErrorCorrection(LibraryContainer& libraries)
@@ -691,6 +934,12 @@ ReadCorrectionHandler::ReadCorrectionHandler(DBGraph& g, const Settings& s) :
         dbg.populateTable();
         cout << "done (" << Util::stopChronoStr() << ")" << endl;
 
+        Util::startChrono();
+        cout << "Creating kmer filter... "; cout.flush();
+        initKmerFilter();
+        cout << "done (" << kmerFilter.getNumBytes() / 1024 << " kB, "
+             << Util::stopChronoStr() << ")" << endl;
+
         Util::startChrono();
         cout << "Building suffix array (sparseness factor: "
              << settings.getEssaMEMSparsenessFactor() << ")..."; cout.flush();
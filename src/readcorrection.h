@@ -23,17 +23,13 @@
 
 #include "settings.h"
 #include "graph.h"
+#include "kmernode.h"
 #include "alignment.h"
+#include "kmerfilter.h"
 #include "essaMEM-master/sparseSA.hpp"
 
 #include <mutex>
 
-// ============================================================================
-// CLASS PROTOTYPES
-// ============================================================================
-
-class NodePosPair;
-
 // ============================================================================
 // ALIGNMENT METRICS CLASS
 // ============================================================================
@@ -43,16 +39,21 @@ class AlignmentMetrics
 private:
         size_t numReads;                // number of reads handled
         size_t numCorrReads;            // number of reads corrected
+        size_t numVerifiedReads;        // number of reads that agree with the graph
         size_t numCorrByMEM;            // number of times MEM procedure was used
         size_t numSubstitutions;        // number of substitutions made to the reads
+        size_t numSearches;             // number of graph searches (DFS)
+        size_t numSearchLimitHits;      // number of searches that hit the node limit
+        size_t numPrunedStates;         // number of pruned revisits of search states
         std::mutex metricMutex;         // mutex for merging metrics
 
 public:
         /**
          * Default constructor
          */
-        AlignmentMetrics() : numReads(0), numCorrReads(0), numCorrByMEM(0),
-                numSubstitutions(0) {}
+        AlignmentMetrics() : numReads(0), numCorrReads(0), numVerifiedReads(0),
+                numCorrByMEM(0), numSubstitutions(0), numSearches(0), numSearchLimitHits(0),
+                numPrunedStates(0) {}
 
         /**
          * Update the statistics
@@ -70,6 +71,28 @@ public:
                 numSubstitutions += numSubstitutions_;
         }
 
+        /**
+         * Update the statistics with a read that agrees with the graph and
+         * was therefore left uncorrected
+         */
+        void addVerifiedObservation() {
+                numReads++;
+                numVerifiedReads++;
+        }
+
+        /**
+         * Update the graph search statistics
+         * @param numSearches_ Number of graph searches
+         * @param numSearchLimitHits_ Number of searches that hit the node limit
+         * @param numPrunedStates_ Number of pruned revisits of search states
+         */
+        void addSearchObservations(size_t numSearches_, size_t numSearchLimitHits_,
+                                   size_t numPrunedStates_) {
+                numSearches += numSearches_;
+                numSearchLimitHits += numSearchLimitHits_;
+                numPrunedStates += numPrunedStates_;
+        }
+
         /**
          * Add other metrics (thread-safe)
          * @param metrics Metrics to add
@@ -92,6 +115,14 @@ public:
                 return numCorrReads;
         }
 
+        /**
+         * Get the number of reads that agree with the graph
+         * @return The number of reads that agree with the graph
+         */
+        size_t getNumVerifiedReads() const {
+                return numVerifiedReads;
+        }
+
         /**
          * Get the number of corrected reads using the MEM procedure
          * @return The number of corrected reads using the MEM procedure
@@ -108,6 +139,14 @@ public:
                 return numSubstitutions;
         }
 
+        /**
+         * Get the number of graph searches that hit the node limit
+         * @return The number of graph searches that hit the node limit
+         */
+        size_t getNumSearchLimitHits() const {
+                return numSearchLimitHits;
+        }
+
         /**
          * Output statistics to the stdout
          */
@@ -118,32 +157,50 @@ public:
 // SEED CLASS
 // ============================================================================
 
+/**
+ * A seed spans a chain of consecutive nodes. The chains of all seeds of a
+ * read are stored back to back in a single node pool, so that seeds can be
+ * copied, sorted and merged without allocating memory.
+ */
 class Seed
 {
 public:
-        std::vector<NodeID> nodeID;     // chain of node IDs
+        NodeID nodeID;                  // first node ID of the chain
+        size_t chainFirst;              // position of the chain in the pool
+        size_t chainEnd;                // end of the chain in the pool
         size_t nodeFirst;               // offset within first node
         size_t readFirst;               // start position in read
         size_t readEnd;                 // end position in read
 
-        Seed() : nodeID(0), nodeFirst(0), readFirst(0), readEnd(0) {}
+        Seed() : nodeID(0), chainFirst(0), chainEnd(0), nodeFirst(0),
+                readFirst(0), readEnd(0) {}
 
-        Seed(NodeID nodeID_, size_t nodeFirst_, size_t readFirst_, size_t readEnd_) :
-             nodeFirst(nodeFirst_), readFirst(readFirst_), readEnd(readEnd_) {
-                nodeID.push_back(nodeID_);
-        }
+        Seed(NodeID nodeID_, size_t chainFirst_, size_t nodeFirst_,
+             size_t readFirst_, size_t readEnd_) :
+             nodeID(nodeID_), chainFirst(chainFirst_), chainEnd(chainFirst_ + 1),
+             nodeFirst(nodeFirst_), readFirst(readFirst_), readEnd(readEnd_) {}
 
         bool operator< (const Seed& rhs) const {
-                if (nodeID.front() != rhs.nodeID.front())
-                        return nodeID.front() < rhs.nodeID.front();
+                if (nodeID != rhs.nodeID)
+                        return nodeID < rhs.nodeID;
                 return nodeFirst < rhs.nodeFirst;
         }
 
+        /**
+         * Get the number of nodes in the chain
+         * @return The number of nodes in the chain
+         */
+        size_t getChainLength() const {
+                return chainEnd - chainFirst;
+        }
+
         /**
          * @param dbg Const-reference to the De Bruijn graph
+         * @param chainPool Node pool that holds the chain of the seed
          * @param npp Node Position pair vector (output)
          */
         void createNodePosition(const DBGraph& dbg,
+                                const std::vector<NodeID>& chainPool,
                                 std::vector<NodePosPair>& npp) const;
 
         static void mergeSeeds(const std::vector<Seed>& seeds,
@@ -175,6 +232,90 @@ public:
         }
 };
 
+// ============================================================================
+// SEARCH STATE TABLE CLASS
+// ============================================================================
+
+/**
+ * Best score per (node, read position) state of a graph search. The table
+ * uses open addressing: a slot belongs to the current search only if it is
+ * stamped with it, so clearing the table between searches is free and the
+ * slots are reused once the table has grown to its working size.
+ */
+class SearchStateTable
+{
+private:
+        std::vector<uint64_t> state;    // state per slot
+        std::vector<int> score;         // best score per slot
+        std::vector<uint32_t> stamp;    // search that filled the slot
+        uint32_t currStamp;             // stamp of the current search
+        size_t numStates;               // number of states of this search
+        int shift;                      // 64 - log2(number of slots)
+
+        /**
+         * Get the home slot of a state
+         * @param s State under consideration
+         * @return The home slot
+         */
+        size_t getSlot(uint64_t s) const {
+                return (s * 0x9E3779B97F4A7C15ull) >> shift;
+        }
+
+        /**
+         * Double the number of slots
+         */
+        void grow();
+
+public:
+        /**
+         * Default constructor
+         */
+        SearchStateTable() : state(1024), score(1024), stamp(1024, 0),
+                currStamp(1), numStates(0), shift(54) {}
+
+        /**
+         * Forget all states (start of a new search)
+         */
+        void clear();
+
+        /**
+         * Record a score for a state
+         * @param s State under consideration
+         * @param newScore Score with which the state is reached
+         * @return false if the state was reached before with at least newScore
+         */
+        bool update(uint64_t s, int newScore);
+};
+
+// ============================================================================
+// CORRECTION WORKSPACE CLASS
+// ============================================================================
+
+/**
+ * Buffers reused across the reads of one thread. Once they have grown to
+ * the size required by the longest read and the largest search, correcting
+ * a read no longer allocates memory.
+ */
+class CorrectionWorkspace
+{
+public:
+        std::vector<NodePosPair> nppv;          // npps after kmer lookup
+        std::vector<NodePosPair> npp;           // npps of the seed under correction
+        std::vector<Seed> seeds;                // unmerged seeds
+        std::vector<Seed> mergedSeeds;          // merged seeds
+        std::vector<NodeID> chainPool;          // node chains of the seeds
+        std::vector<match_t> matches;           // essaMEM matches
+        std::string correctedRead;              // read corrected from one seed
+        std::string bestCorrectedRead;          // best corrected read
+
+        SearchStateTable searchStates;          // states of the current search
+        std::vector<std::vector<DFSNode> > dfsStack;    // children per search depth
+        std::vector<NodeID> nextIDs;            // children of a search node
+        std::string nodeOL;                     // overlaps of the children with the read
+        std::vector<size_t> nodeOLFirst;        // start of each overlap in nodeOL
+        std::vector<int> OLScore;               // alignment score of each overlap
+};
+
 // ============================================================================
 // READ CORRECTION CLASS
 // ============================================================================
@@ -187,6 +328,12 @@ private:
         AlignmentJan alignment;
         const sparseSA& sa;
         const std::vector<long>& startpos;
+        const KmerFilter& kmerFilter;
+
+        CorrectionWorkspace ws;         // buffers reused across reads
+        size_t numSearches;             // graph searches of the current read
+        size_t numSearchLimitHits;      // searches that hit the node limit
+        size_t numPrunedStates;         // pruned revisits of search states
 
         /**
          * Get the marginal length of a string
@@ -214,7 +361,7 @@ private:
          * Correct a specific read record
          * @param TODO
          */
-        void correctRead(std::string& read, std::vector<NodePosPair> npp,
+        void correctRead(std::string& read, std::vector<NodePosPair>& npp,
                          size_t& first, size_t& last);
 
         /**
@@ -256,11 +403,18 @@ private:
 
         void recSearch(NodeID curr, string& read, vector<NodePosPair>& npp,
                        size_t currPos, size_t& counter, int score,
-                       int& bestScore, size_t& seedLast);
+                       int& bestScore, size_t& seedLast, size_t depth = 0);
 
         void revCompl(vector<NodePosPair>& npp);
 
-        void findSeedKmer(const std::string& read,
+        /**
+         * Find the seeds of a read using the kmer lookup table
+         * @param read Reference to the read
+         * @param seeds Merged seeds (output)
+         * @return True if a single consistent seed covers all kmers of the
+         * read, i.e. the read agrees with a path in the graph
+         */
+        bool findSeedKmer(const std::string& read,
                           std::vector<Seed>& seeds);
 
         /**
@@ -279,11 +433,15 @@ public:
          * Default constructor
          * @param dbg_ Reference to the De Bruijn graph
          * @param settings_ Reference to the settings class
+         * @param kmerFilter_ Filter of the kmers in the graph
          */
         ReadCorrection(const DBGraph& dbg_, const Settings& settings_,
-                          const sparseSA& sa_, const std::vector<long>& startpos_) :
+                          const sparseSA& sa_, const std::vector<long>& startpos_,
+                          const KmerFilter& kmerFilter_) :
                           dbg(dbg_), settings(settings_),
-                          alignment(100, 2, 1, -1, -3), sa(sa_), startpos(startpos_) {}
+                          alignment(100, 2, 1, -1, -3), sa(sa_), startpos(startpos_),
+                          kmerFilter(kmerFilter_),
+                          numSearches(0), numSearchLimitHits(0), numPrunedStates(0) {}
 
         /**
          * Correct the records in one chunk
@@ -304,11 +462,39 @@ private:
         DBGraph &dbg;
         const Settings &settings;
         sparseSA *sa;
-        std::string reference;
+        packed_text reference;
         std::vector<long> startpos;
+        KmerFilter kmerFilter;          // filter of the kmers in the graph
 
         void initEssaMEM();
 
+        /**
+         * Insert all kmers of the graph into the kmer filter
+         */
+        void initKmerFilter();
+
+        /**
+         * Get the filename prefix of the cached essaMEM index
+         * @return The filename prefix
+         */
+        std::string getEssaMEMCachePrefix() const {
+                return settings.addTempDirectory("essamem.stage4");
+        }
+
+        /**
+         * Load the essaMEM index from the cache, if it was built for the
+         * same reference and sparseness factor
+         * @param key Hash of the reference and the sparseness factor
+         * @return True if the index was loaded
+         */
+        bool loadEssaMEMCache(uint64_t key);
+
+        /**
+         * Save the essaMEM index to the cache
+         * @param key Hash of the reference and the sparseness factor
+         */
+        void saveEssaMEMCache(uint64_t key);
+
         /**
          * Entry routine for worker thread
          * @param myID Unique threadID
@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 2014, 2015 Jan Fostier (jan.fostier@intec.ugent.be)     *
+ *   Copyright (C) 2014, 2015 Mahdi Heydari (mahdi.heydari@intec.ugent.be) *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "seqpool.h"
+#include <algorithm>
+
+using namespace std;
+
+void SequencePool::addSlab(size_t minSize)
+{
+        // oversized sequences get a slab of their own
+        size_t size = max(minSize, slabSize);
+        slabs.push_back(new uint8_t[size]);
+        slabOffset = 0;
+        slabCapacity = size;
+}
+
+uint8_t* SequencePool::allocate(size_t numBytes)
+{
+        if (numBytes == 0)
+                return NULL;
+
+        if (slabOffset + numBytes > slabCapacity)
+                addSlab(numBytes);
+
+        uint8_t *slice = slabs.back() + slabOffset;
+        slabOffset += numBytes;
+        numBytesAllocated += numBytes;
+
+        return slice;
+}
+
+void SequencePool::clear()
+{
+        for (size_t i = 0; i < slabs.size(); i++)
+                delete [] slabs[i];
+        slabs.clear();
+
+        slabOffset = slabCapacity = 0;
+        numBytesAllocated = numBytesReleased = 0;
+        sharedSlices = false;
+}
+
+void SequencePool::swap(SequencePool& rhs)
+{
+        std::swap(slabSize, rhs.slabSize);
+        slabs.swap(rhs.slabs);
+        std::swap(slabOffset, rhs.slabOffset);
+        std::swap(slabCapacity, rhs.slabCapacity);
+        std::swap(numBytesAllocated, rhs.numBytesAllocated);
+        std::swap(numBytesReleased, rhs.numBytesReleased);
+        std::swap(sharedSlices, rhs.sharedSlices);
+}
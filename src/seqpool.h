@@ -0,0 +1,172 @@
+/***************************************************************************
+ *   Copyright (C) 2014, 2015 Jan Fostier (jan.fostier@intec.ugent.be)     *
+ *   Copyright (C) 2014, 2015 Mahdi Heydari (mahdi.heydari@intec.ugent.be) *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef SEQPOOL_H
+#define SEQPOOL_H
+
+#include "global.h"
+#include <vector>
+#include <cstddef>
+
+// ============================================================================
+// SEQUENCE POOL CLASS
+// ============================================================================
+
+/**
+ * Arena for 2-bit packed node sequences. Memory is handed out as slices of
+ * large slabs; slices are never freed individually. Released bytes are only
+ * accounted for and reclaimed by copying the live sequences to a fresh pool.
+ */
+class SequencePool {
+
+private:
+        size_t slabSize;                // default size of a slab (in bytes)
+        std::vector<uint8_t*> slabs;    // slabs of 2-bit packed sequences
+        size_t slabOffset;              // first free byte in the last slab
+        size_t slabCapacity;            // capacity of the last slab
+
+        size_t numBytesAllocated;       // number of bytes handed out
+        size_t numBytesReleased;        // number of bytes no longer in use
+        bool sharedSlices;              // true if slices are shared
+
+        /**
+         * Add a new slab of at least a certain size
+         * @param minSize Minimum size of the slab (in bytes)
+         */
+        void addSlab(size_t minSize);
+
+public:
+        /**
+         * Default constructor
+         * @param slabSize Default size of a slab (in bytes)
+         */
+        SequencePool(size_t slabSize = SEQUENCE_SLAB_SIZE) :
+                slabSize(slabSize), slabOffset(0), slabCapacity(0),
+                numBytesAllocated(0), numBytesReleased(0),
+                sharedSlices(false) {}
+
+        /**
+         * Destructor
+         */
+        ~SequencePool() {
+                clear();
+        }
+
+        /**
+         * Delete the copy constructor
+         */
+        SequencePool(const SequencePool&) = delete;
+
+        /**
+         * Delete the assignment operator
+         */
+        void operator=(const SequencePool&) = delete;
+
+        /**
+         * Allocate a slice of memory from the pool
+         * @param numBytes Number of bytes to allocate
+         * @return Pointer to the slice (NULL if numBytes == 0)
+         */
+        uint8_t* allocate(size_t numBytes);
+
+        /**
+         * Account for a block of sequence memory that is owned elsewhere
+         * (e.g. a memory-mapped file). The block is never freed by the pool.
+         * @param numBytes Size of the block (in bytes)
+         * @param shared True if the slices are also used by another graph
+         */
+        void addBorrowedSlab(size_t numBytes, bool shared = false) {
+                numBytesAllocated += numBytes;
+                sharedSlices = sharedSlices || shared;
+                // further allocations go to a fresh slab
+                slabOffset = slabCapacity = 0;
+        }
+
+        /**
+         * Mark a number of bytes as no longer in use
+         * @param numBytes Number of bytes that became dead
+         */
+        void release(size_t numBytes) {
+                numBytesReleased += numBytes;
+        }
+
+        /**
+         * Free all slabs
+         */
+        void clear();
+
+        /**
+         * Swap the contents of two pools
+         * @param rhs Pool to swap with
+         */
+        void swap(SequencePool& rhs);
+
+        /**
+         * Check whether slices may be shared with another graph, in which
+         * case they must never be overwritten in place (copy-on-write)
+         * @return True or false
+         */
+        bool hasSharedSlices() const {
+                return sharedSlices;
+        }
+
+        /**
+         * Get the number of slabs
+         * @return The number of slabs
+         */
+        size_t getNumSlabs() const {
+                return slabs.size();
+        }
+
+        /**
+         * Get the number of bytes handed out
+         * @return The number of bytes handed out
+         */
+        size_t getNumBytesAllocated() const {
+                return numBytesAllocated;
+        }
+
+        /**
+         * Get the number of bytes that are no longer in use
+         * @return The number of dead bytes
+         */
+        size_t getNumBytesReleased() const {
+                return numBytesReleased;
+        }
+
+        /**
+         * Get the number of bytes still in use
+         * @return The number of live bytes
+         */
+        size_t getNumBytesLive() const {
+                return numBytesAllocated - numBytesReleased;
+        }
+
+        /**
+         * Check whether the pool contains enough dead space to be compacted
+         * @return True if the pool should be compacted
+         */
+        bool needsCompaction() const {
+                return numBytesReleased > SEQUENCE_COMPACT_RATIO * numBytesAllocated;
+        }
+};
+
+#endif
@@ -66,7 +66,8 @@ void Settings::printUsage() const
         cout << " [options]\n";
         cout << "  -h\t--help\t\t\tdisplay help page\n";
         cout << "  -i\t--info\t\t\tdisplay information page\n";
-        cout << "  -s\t--singlestranded\tenable single stranded DNA [default = false]\n\n";
+        cout << "  -s\t--singlestranded\tenable single stranded DNA [default = false]\n";
+        cout << "  -C\t--components\t\tcorrect the connected components of the graph in parallel [default = false]\n\n";
 
         cout << " [options arg]\n";
         cout << "  -k\t--kmersize\t\tkmer size [default = 31]\n";
@@ -92,7 +93,8 @@ void Settings::printUsage() const
 
 Settings::Settings() : kmerSize(31), numThreads(std::thread::hardware_concurrency()),
         doubleStranded(true), essaMEMSparsenessFactor(1), bubbleDFSNodeLimit(1000),
-        readCorrDFSNodeLimit(1000), covCutoff(0), skipStage4(false), skipStage5(false) {}
+        readCorrDFSNodeLimit(1000), covCutoff(0), skipStage4(false), skipStage5(false),
+        componentPurification(false) {}
 
 void Settings::parseCommandLineArguments(int argc, char** args,
                                          LibraryContainer& libCont)
@@ -148,6 +150,8 @@ void Settings::parseCommandLineArguments(int argc, char** args,
                                 covCutoff = atoi(args[i]);
                 } else if ((arg == "-s") || (arg == "--singlestranded")) {
                         doubleStranded = false;
+                } else if ((arg == "-C") || (arg == "--components")) {
+                        componentPurification = true;
                 } else if ((arg == "-p") || (arg == "--pathtotmp")) {
                         i++;
                         if (i < argc)
@@ -58,6 +58,7 @@ private:
         double covCutoff;               // coverage cutoff value to separate true and false nodes based on their node-kmer-coverage
         bool skipStage4;                // true if stage 4 should be skipped
         bool skipStage5;                // true if stage 5 should be skipped
+        bool componentPurification;     // purify the graph per connected component
 
 public:
         /**
@@ -146,6 +147,14 @@ public:
                 return readCorrDFSNodeLimit;
         }
 
+        /**
+         * True if the connected components are purified in parallel
+         * @return True if the connected components are purified in parallel
+         */
+        bool getComponentPurification() const {
+                return componentPurification;
+        }
+
         /**
          * True if stage 4 should be skipped
          * @return True if stage 4 should be skipped
@@ -251,9 +251,9 @@ struct readStructStr
 void DBGraph::compareToSolution(const string& filename, bool load)
 {
 #ifdef DEBUG
+        // read the reference genome (genome.fasta) from disk, once
+        readReferenceGenome();
         if (load){
-                // read the reference genome (genome.fasta) from disk
-                readReferenceGenome();
                 // try reading the multiplicity file from disk
                 trueMult.resize(numNodes + 1);
                 cout << "Building a new multiplicity file" << endl;
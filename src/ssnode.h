@@ -34,7 +34,7 @@
 class SSNode {
 
 private:
-        static DSNode *nodes;   // pointer to the double stranded nodes
+        static thread_local DSNode *nodes;      // pointer to the double stranded nodes (per thread)
 
         NodeID nodeID;          // identiffier of the node
         DSNode *dsNode;         // reference to the double stranded node
@@ -516,6 +516,22 @@ public:
                         return Nucleotide::getRevCompl(dsNode->substr(getLength() - len - offset, len));
         }
 
+        /**
+         * Copy a subsequence of this node to a character buffer, without
+         * creating intermediate strings
+         * @param offset Start offset
+         * @param len Number of nucleotides to copy
+         * @param dst Destination buffer of at least len characters
+         */
+        void copySubstr(size_t offset, size_t len, char *dst) const {
+                if (nodeID > 0) {
+                        dsNode->copySubstr(offset, len, dst);
+                } else {
+                        dsNode->copySubstr(getLength() - len - offset, len, dst);
+                        Nucleotide::revCompl(dst, len);
+                }
+        }
+
         /**
          * Get a nucleotide at a specified position ('-' for out-of bounds)
          * @param pos Position in the sequence
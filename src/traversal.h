@@ -0,0 +1,149 @@
+/***************************************************************************
+ *   Copyright (C) 2014, 2015 Jan Fostier (jan.fostier@intec.ugent.be)     *
+ *   Copyright (C) 2014, 2015 Mahdi Heydari (mahdi.heydari@intec.ugent.be) *
+ *   This file is part of Brownie                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef TRAVERSAL_H
+#define TRAVERSAL_H
+
+#include "global.h"
+#include "bucketqueue.h"
+#include <vector>
+#include <algorithm>
+
+// ============================================================================
+// TRAVERSAL WORKSPACE CLASS
+// ============================================================================
+
+/**
+ * Scratch space for graph traversals, indexed by oriented node identifier.
+ * Entries are only valid if they were set during the current epoch, so
+ * starting a new traversal does not require clearing the arrays. Every
+ * thread should use a workspace of its own.
+ */
+class TraversalWorkspace {
+
+private:
+        NodeID numNodes;                // number of nodes in the graph
+        uint32_t epoch;                 // identifier of the current traversal
+        std::vector<uint32_t> stamp;    // epoch in which an entry was set
+        std::vector<NodeID> prevNode;   // predecessor on the traversal
+        std::vector<NodeID> nodeColor;  // first node after the root
+        std::vector<NodeID> visited;    // nodes visited in this epoch
+        BucketQueue<NodeID> queue;      // queue for bounded length searches
+
+public:
+        /**
+         * Default constructor
+         * @param numNodes Number of nodes in the graph
+         */
+        TraversalWorkspace(NodeID numNodes = 0) : numNodes(0), epoch(1) {
+                resize(numNodes);
+        }
+
+        /**
+         * Resize the workspace for a graph with a different number of nodes
+         * @param numNodes_ Number of nodes in the graph
+         */
+        void resize(NodeID numNodes_) {
+                numNodes = numNodes_;
+                stamp.assign(2*numNodes+1, 0);
+                prevNode.resize(2*numNodes+1);
+                nodeColor.resize(2*numNodes+1);
+                visited.clear();
+                epoch = 1;
+        }
+
+        /**
+         * Get the number of nodes the workspace is sized for
+         * @return The number of nodes
+         */
+        NodeID getNumNodes() const {
+                return numNodes;
+        }
+
+        /**
+         * Start a new traversal, all nodes become unvisited
+         */
+        void reset() {
+                visited.clear();
+                if (++epoch == 0) {     // wrap-around: clear the stamps
+                        std::fill(stamp.begin(), stamp.end(), 0);
+                        epoch = 1;
+                }
+        }
+
+        /**
+         * Mark a node as visited
+         * @param nodeID Identifier of the node
+         * @param prev Identifier of the predecessor (!= 0)
+         * @param color Color of the node
+         */
+        void visit(NodeID nodeID, NodeID prev, NodeID color) {
+                stamp[nodeID + numNodes] = epoch;
+                prevNode[nodeID + numNodes] = prev;
+                nodeColor[nodeID + numNodes] = color;
+                visited.push_back(nodeID);
+        }
+
+        /**
+         * Check whether a node was visited in the current traversal
+         * @param nodeID Identifier of the node
+         * @return True or false
+         */
+        bool isVisited(NodeID nodeID) const {
+                return stamp[nodeID + numNodes] == epoch;
+        }
+
+        /**
+         * Get the predecessor of a node
+         * @param nodeID Identifier of the node
+         * @return The predecessor (0 if the node was not visited)
+         */
+        NodeID getPrevNode(NodeID nodeID) const {
+                return isVisited(nodeID) ? prevNode[nodeID + numNodes] : 0;
+        }
+
+        /**
+         * Get the color of a node
+         * @param nodeID Identifier of the node
+         * @return The color (0 if the node was not visited)
+         */
+        NodeID getColor(NodeID nodeID) const {
+                return isVisited(nodeID) ? nodeColor[nodeID + numNodes] : 0;
+        }
+
+        /**
+         * Get the queue for bounded length searches
+         * @return A reference to the queue
+         */
+        BucketQueue<NodeID>& getQueue() {
+                return queue;
+        }
+
+        /**
+         * Get the nodes visited in the current traversal
+         * @return The visited nodes, in order of visit
+         */
+        const std::vector<NodeID>& getVisited() const {
+                return visited;
+        }
+};
+
+#endif
@@ -31,12 +31,12 @@ const uint8_t TString::nucleotideMask = 3;
 
 using namespace std;
 
-TString::TString(string str) : length(0), buf(NULL)
+TString::TString(string str) : length(0), pooled(false), buf(NULL)
 {
         setSequence(str);
 }
 
-TString::TString(ifstream& ifs)
+TString::TString(ifstream& ifs) : pooled(false)
 {
         ifs.read((char*)&length, sizeof(length));
         if (!ifs.good())
@@ -61,8 +61,8 @@ void TString::read(ifstream& ifs)
 
         // store the actual string
         size_t numBytes = (length + 3) / 4;
-        if (numBytes > oldNumBytes) {
-                delete [] buf;
+        if (pooled || (numBytes > oldNumBytes)) {
+                freeBuffer();
                 buf = new uint8_t[numBytes];
         }
 
@@ -71,14 +71,51 @@ void TString::read(ifstream& ifs)
 
 void TString::setSequence(const std::string& str)
 {
-        size_t strSize = str.size();
-
-        size_t numBytes = (strSize + 3) / 4;
-        if (((length + 3) / 4) != numBytes) {
-                delete [] buf;
+        size_t numBytes = (str.size() + 3) / 4;
+        if (pooled || (((length + 3) / 4) != numBytes)) {
+                freeBuffer();
                 buf = new uint8_t[numBytes];
         }
 
+        encode(str);
+}
+
+void TString::setSequence(const std::string& str, SequencePool& pool)
+{
+        size_t oldNumBytes = (length + 3) / 4;
+        size_t numBytes = (str.size() + 3) / 4;
+
+        if (pooled && (numBytes <= oldNumBytes) && !pool.hasSharedSlices()) {
+                // the slice is large enough: overwrite in place
+                pool.release(oldNumBytes - numBytes);
+        } else {
+                if (pooled)
+                        pool.release(oldNumBytes);
+                freeBuffer();
+                buf = pool.allocate(numBytes);
+                pooled = true;
+        }
+
+        encode(str);
+}
+
+void TString::moveToPool(SequencePool& pool)
+{
+        size_t numBytes = (length + 3) / 4;
+        uint8_t *dstBuf = pool.allocate(numBytes);
+        if (numBytes > 0)
+                memcpy(dstBuf, buf, numBytes);
+
+        freeBuffer();
+        buf = dstBuf;
+        pooled = true;
+}
+
+void TString::encode(const std::string& str)
+{
+        size_t strSize = str.size();
+
+        size_t numBytes = (strSize + 3) / 4;
         memset(buf, 0, numBytes);
 
         // store the length of the string
@@ -109,13 +146,20 @@ string TString::substr(size_t offset, size_t len) const
                 return string();
 
         len = min(len, length - offset);
-        string result;
-        result.reserve(len);
+        string result(len, 'A');
+        copySubstr(offset, len, &result[0]);
+
+        return result;
+}
+
+void TString::copySubstr(size_t offset, size_t len, char *dst) const
+{
+        assert(offset + len <= length);
 
         size_t byteID = offset / 4, byteOff = 2 * (offset % 4);
 
-        for (size_t i = offset; i < offset + len; i++) {
-                result.push_back(Nucleotide::nucleotideToChar(buf[byteID] >> byteOff));
+        for (size_t i = 0; i < len; i++) {
+                dst[i] = Nucleotide::nucleotideToChar(buf[byteID] >> byteOff);
 
                 byteOff += 2;
                 if (byteOff == 8)  {
@@ -123,8 +167,6 @@ string TString::substr(size_t offset, size_t len) const
                         byteID++;
                 }
         }
-
-        return result;
 }
 
 void TString::complement()
@@ -286,10 +328,92 @@ void TString::append(const TString& tString)
         if (dstByteID < tBytes)
                 dstBuf[dstByteID] |= tString.buf[rBytes-1] >> cDstBitOff;
 
-        delete [] buf;
+        freeBuffer();
         buf = dstBuf;
 }
 
+/**
+ * Read up to 32 nucleotides from a 2-bit packed buffer into a single word
+ * @param buf 2-bit packed buffer
+ * @param offset Offset of the first nucleotide
+ * @param len Number of nucleotides (<= 32)
+ * @return Word containing the nucleotides (LSB first)
+ */
+static inline uint64_t getPackedWord(const uint8_t *buf, size_t offset, size_t len)
+{
+        const uint8_t *p = buf + offset / 4;
+        size_t shift = 2 * (offset % 4);
+        size_t numBytes = (shift / 2 + len + 3) / 4;
+
+        uint64_t word = 0;
+        memcpy(&word, p, min<size_t>(numBytes, 8));
+        word >>= shift;
+        if (numBytes > 8)
+                word |= uint64_t(p[8]) << (64 - shift);
+
+        if (len < 32)
+                word &= (uint64_t(1) << (2 * len)) - 1;
+        return word;
+}
+
+/**
+ * Write up to 32 nucleotides to a zero-initialized 2-bit packed buffer
+ * @param buf 2-bit packed buffer
+ * @param offset Offset of the first nucleotide
+ * @param word Word containing the nucleotides (LSB first)
+ * @param len Number of nucleotides (<= 32)
+ */
+static inline void putPackedWord(uint8_t *buf, size_t offset, uint64_t word, size_t len)
+{
+        uint8_t *p = buf + offset / 4;
+        size_t shift = 2 * (offset % 4);
+        size_t numBytes = (shift / 2 + len + 3) / 4;
+
+        uint64_t lo = word << shift;
+        for (size_t i = 0; i < min<size_t>(numBytes, 8); i++)
+                p[i] |= uint8_t(lo >> (8 * i));
+        if (numBytes > 8)
+                p[8] |= uint8_t(word >> (64 - shift));
+}
+
+/**
+ * Reverse complement a word of up to 32 nucleotides
+ * @param w Word containing the nucleotides (LSB first)
+ * @param len Number of nucleotides (<= 32)
+ * @return The reverse complement of the word
+ */
+static inline uint64_t revComplWord(uint64_t w, size_t len)
+{
+        w = (((w & 0xccccccccccccccccull) >> 2) |
+             ((w & 0x3333333333333333ull) << 2));
+        w = (((w & 0xf0f0f0f0f0f0f0f0ull) >> 4) |
+             ((w & 0x0f0f0f0f0f0f0f0full) << 4));
+        w = (((w & 0xff00ff00ff00ff00ull) >> 8) |
+             ((w & 0x00ff00ff00ff00ffull) << 8));
+        w = (((w & 0xffff0000ffff0000ull) >> 16) |
+             ((w & 0x0000ffff0000ffffull) << 16));
+        w = (((w & 0xffffffff00000000ull) >> 32) |
+             ((w & 0x00000000ffffffffull) << 32));
+
+        return (~w) >> (64 - 2 * len);
+}
+
+void TString::copyPacked(const uint8_t *src, size_t srcOffset, size_t len,
+                         bool revCompl, uint8_t *dst, size_t dstOffset)
+{
+        for (size_t i = 0; i < len; i += 32) {
+                size_t n = min<size_t>(32, len - i);
+
+                uint64_t word;
+                if (revCompl)
+                        word = revComplWord(getPackedWord(src, srcOffset + len - i - n, n), n);
+                else
+                        word = getPackedWord(src, srcOffset + i, n);
+
+                putPackedWord(dst, dstOffset + i, word, n);
+        }
+}
+
 char TString::operator[](int index) const
 {
         size_t byteID = index / 4;
@@ -27,6 +27,7 @@
 #include <iostream>
 #include <fstream>
 #include "nucleotide.h"
+#include "seqpool.h"
 #include <string>
 #include <iostream>
 
@@ -146,12 +147,29 @@ private:
          */
         void initOffsets(size_t &byteID, size_t &byteOff) const;
 
+        /**
+         * Encode an stl string into the (allocated) buffer
+         * @param str String containing only 'A', 'C', 'G' and 'T'
+         */
+        void encode(const std::string &str);
+
+        /**
+         * Free the buffer if it is owned by this tight string
+         */
+        void freeBuffer() {
+                if (!pooled)
+                        delete [] buf;
+                buf = NULL;
+                pooled = false;
+        }
+
         static const uint8_t charToNucleotideLookup[4];
         static const char charMask;
         static const char nucleotideToCharLookup[4];
         static const uint8_t nucleotideMask;
 
         uint32_t length;        // number of nucleotides in the string
+        bool pooled;            // true if buf is a slice of a SequencePool
         uint8_t * buf;          // 2 bit encoding of sequence
 
 public:
@@ -161,7 +179,7 @@ public:
         /**
          * Default constructor
          */
-        TString() : length(0), buf(NULL) {}
+        TString() : length(0), pooled(false), buf(NULL) {}
 
         /**
          * Constructor from an stl string
@@ -172,7 +190,7 @@ public:
         /**
          * Destructor
          */
-        ~TString() { delete [] buf; }
+        ~TString() { freeBuffer(); }
 
         /**
          * Create a tstring from an input file stream
@@ -202,6 +220,47 @@ public:
          */
         void setSequence(const std::string &str);
 
+        /**
+         * Set the sequence from an stl string and store it in a pool
+         * @param str String containing only 'A', 'C', 'G' and 'T'
+         * @param pool Sequence pool to store the string in
+         */
+        void setSequence(const std::string &str, SequencePool &pool);
+
+        /**
+         * Copy the sequence to a (different) sequence pool
+         * @param pool Destination sequence pool
+         */
+        void moveToPool(SequencePool &pool);
+
+        /**
+         * Let the tight string refer to a 2-bit packed slice of pool memory
+         * @param slice Pointer to the 2-bit packed sequence
+         * @param len Number of nucleotides
+         */
+        void setPooledSlice(uint8_t *slice, uint32_t len) {
+                freeBuffer();
+                buf = slice;
+                length = len;
+                pooled = true;
+        }
+
+        /**
+         * Get a pointer to the 2-bit encoded sequence
+         * @return Pointer to the 2-bit encoded sequence
+         */
+        const uint8_t* getData() const {
+                return buf;
+        }
+
+        /**
+         * Check whether the sequence is stored in a sequence pool
+         * @return True or false
+         */
+        bool isPooled() const {
+                return pooled;
+        }
+
         /**
          * Get the sequence and save as stl string
          * @return Stl string containing the sequence
@@ -216,6 +275,14 @@ public:
          */
         std::string substr(size_t offset, size_t len) const;
 
+        /**
+         * Copy a subsequence of this string to a character buffer
+         * @param offset Start offset
+         * @param len Number of nucleotides to copy (within the string)
+         * @param dst Destination buffer of at least len characters
+         */
+        void copySubstr(size_t offset, size_t len, char *dst) const;
+
         /**
          * Complement the tight string
          */
@@ -245,12 +312,25 @@ public:
          */
         void append(const TString &tString);
 
+        /**
+         * Copy 2-bit packed nucleotides to a zero-initialized buffer, 32
+         * nucleotides at a time
+         * @param src Source buffer
+         * @param srcOffset Offset of the first nucleotide in the source
+         * @param len Number of nucleotides to copy
+         * @param revCompl True if the reverse complement should be copied
+         * @param dst Destination buffer
+         * @param dstOffset Offset of the first nucleotide in the destination
+         */
+        static void copyPacked(const uint8_t *src, size_t srcOffset,
+                               size_t len, bool revCompl,
+                               uint8_t *dst, size_t dstOffset);
+
         /**
          * Clear the contents of the tight string
          */
         void clear() {
-                delete [] buf;
-                buf = NULL;
+                freeBuffer();
                 length = 0;
         }
 
@@ -84,7 +84,29 @@ string Util::getDateTime()
         return string(ctime(&time));
 }
 
+double Util::logFactorial(unsigned int k)
+{
+        // initialized once, thread-safe as of C++11
+        static const vector<double> table = createLogFactorialTable();
+
+        if (k < table.size())
+                return table[k];
+
+        // lgamma() writes the global signgam, lgamma_r() is reentrant
+        int sign;
+        return lgamma_r(k+1, &sign);
+}
+
+vector<double> Util::createLogFactorialTable()
+{
+        vector<double> table(LOG_FACTORIAL_TABLE_SIZE);
+        int sign;
+        for (unsigned int k = 0; k < table.size(); k++)
+                table[k] = lgamma_r(k+1, &sign);
+        return table;
+}
+
 double Util::poissonPDF(unsigned int k, double mu)
 {
-        return exp(k*log(mu)-mu-lgamma(k+1));
+        return exp(k*log(mu)-mu-logFactorial(k));
 }
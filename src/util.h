@@ -26,6 +26,7 @@
 #include <chrono>
 #include <ctime>
 #include <fstream>
+#include <vector>
 #define MAX_TIMERS 16
 
 /**
@@ -37,6 +38,12 @@ private:
         static int currentTimer;
         static std::chrono::time_point<std::chrono::system_clock> startTime[MAX_TIMERS];
 
+        /**
+         * Tabulate log(k!) for small k
+         * @return The table with log(k!)
+         */
+        static std::vector<double> createLogFactorialTable();
+
 public:
         /**
          * Create a string with a human readable version of a time period
@@ -97,6 +104,13 @@ public:
                 return OK;
         }
 
+        /**
+         * Compute log(k!), small values come from a table
+         * @param k Number
+         * @return log(k!), i.e. lgamma(k+1)
+         */
+        static double logFactorial(unsigned int k);
+
         /**
          * Compute the probability p(k) from a Poisson distribution with mean mu
          * @param k Number of observations
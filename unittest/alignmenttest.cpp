@@ -20,6 +20,8 @@
 
 #include <gtest/gtest.h>
 #include "../src/alignment.h"
+#include <cstdlib>
+#include <climits>
 
 using namespace std;
 
@@ -53,3 +55,94 @@ TEST(Alignment, AlignmentTest)
 
         ASSERT_EQ(score, 6);
 }
+
+TEST(Alignment, AlignScoreTest)
+{
+        // the banded kernel must reproduce the scores of the full matrix
+        srand(11);
+        for (int maxIndel = 1; maxIndel <= 4; maxIndel++) {
+                AlignmentJan align(10, maxIndel, 2, -1, -2 - maxIndel);
+                for (int iter = 0; iter < 500; iter++) {
+                        string s1, s2;
+                        for (int i = rand() % 120; i > 0; i--)
+                                s1.push_back("ACGTN"[rand() % 21 / 5]);
+
+                        // random substitutions and indels
+                        s2 = s1;
+                        for (int e = rand() % 6; e > 0; e--) {
+                                size_t pos = rand() % (s2.size() + 1);
+                                if (rand() % 2 == 0 && pos < s2.size())
+                                        s2[pos] = "ACGTN"[rand() % 21 / 5];
+                                else if (rand() % 2 == 0)
+                                        s2.insert(pos, 1, "ACGT"[rand() % 4]);
+                                else if (pos < s2.size())
+                                        s2.erase(pos, 1);
+                        }
+
+                        int diff = (int)s1.size() - (int)s2.size();
+                        if (diff > maxIndel || diff < -maxIndel)
+                                continue;
+
+                        ASSERT_EQ(align.alignScore(s1, s2), align.align(s1, s2));
+                        ASSERT_EQ(align.alignScore(s2, s1), align.align(s2, s1));
+                }
+        }
+
+        AlignmentJan align(10, 3, 1, -1, -3);
+        EXPECT_EQ(align.alignScore("ACGTACGTAC", "ACGTACGCAC"), 8);
+        EXPECT_EQ(align.alignScore("ACGTACGTAC", "ACGTACCGTAC"), 7);
+        EXPECT_EQ(align.alignScore("ACGTACGTAC", "ACGTAGTAC"), 6);
+        EXPECT_EQ(align.alignScore("ACGTACGTAC", "ACGTAC"), INT_MIN / 2);
+}
+
+TEST(Alignment, AlignBatchTest)
+{
+        // every candidate gets the score of its own window
+        srand(13);
+        AlignmentJan align(10, 2, 1, -1, -3);
+        for (int iter = 0; iter < 300; iter++) {
+                string s1;
+                for (int i = rand() % 150; i > 0; i--)
+                        s1.push_back("ACGTN"[rand() % 21 / 5]);
+                size_t offset = rand() % (s1.size() + 1);
+
+                vector<string> s2;
+                for (int c = rand() % (2 * ALIGNMENT_BATCH_SIZE + 2); c > 0; c--) {
+                        string cand = s1.substr(offset, rand() % (s1.size() - offset + 1));
+                        for (size_t j = 0; j < cand.size(); j++)
+                                if (rand() % 10 == 0)
+                                        cand[j] = "ACGTN"[rand() % 21 / 5];
+                        if (!cand.empty() && rand() % 3 == 0) {
+                                // a deletion and an insertion
+                                cand.erase(rand() % cand.size(), 1);
+                                cand.insert(rand() % (cand.size() + 1), 1, 'A');
+                        }
+                        s2.push_back(cand);
+                }
+
+                // candidates back to back
+                string concat;
+                vector<size_t> first(1, 0);
+                for (size_t c = 0; c < s2.size(); c++) {
+                        concat += s2[c];
+                        first.push_back(concat.size());
+                }
+
+                vector<int> scores;
+                align.alignBatch(s1, offset, concat, first, scores);
+                ASSERT_EQ(scores.size(), s2.size());
+                for (size_t c = 0; c < s2.size(); c++) {
+                        string window = s1.substr(offset, s2[c].size());
+                        ASSERT_EQ(scores[c], align.alignScore(window, s2[c]));
+                }
+        }
+
+        // windows too long for 16-bit lanes
+        string s1(8000, 'A');
+        string s2 = string(7000, 'C') + string(10, 'A');
+        vector<size_t> first = {0, 7000, 7010};
+        vector<int> scores;
+        align.alignBatch(s1, 100, s2, first, scores);
+        EXPECT_EQ(scores[0], -7000);
+        EXPECT_EQ(scores[1], 10);
+}
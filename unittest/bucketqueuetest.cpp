@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <queue>
+#include <cstdlib>
+#include "bucketqueue.h"
+
+using namespace std;
+
+TEST(BucketQueue, monotoneOrder)
+{
+        BucketQueue<int> queue(10);
+        queue.push(3, 30);
+        queue.push(0, 0);
+        queue.push(3, 31);
+        queue.push(1, 10);
+
+        size_t key;
+        EXPECT_EQ(queue.pop(key), 0);
+        EXPECT_EQ(key, 0u);
+        EXPECT_EQ(queue.pop(key), 10);
+
+        // pushing at the current key is allowed
+        queue.push(1, 11);
+        EXPECT_EQ(queue.pop(key), 11);
+        EXPECT_EQ(key, 1u);
+
+        // FIFO order within a key
+        EXPECT_EQ(queue.pop(key), 30);
+        EXPECT_EQ(queue.pop(key), 31);
+        EXPECT_EQ(key, 3u);
+        EXPECT_EQ(queue.empty(), true);
+
+        // a reset queue can be reused
+        queue.push(5, 50);
+        queue.reset(20);
+        EXPECT_EQ(queue.empty(), true);
+        queue.push(20, 200);
+        EXPECT_EQ(queue.pop(key), 200);
+        EXPECT_EQ(key, 20u);
+}
+
+TEST(BucketQueue, matchesPriorityQueue)
+{
+        // Dijkstra-like usage: keys only grow from the popped key
+        BucketQueue<size_t> queue(1000);
+        priority_queue<size_t, vector<size_t>, greater<size_t> > heap;
+
+        srand(7);
+        queue.push(0, 0);
+        heap.push(0);
+        while (!heap.empty()) {
+                size_t key;
+                size_t value = queue.pop(key);
+                EXPECT_EQ(value, heap.top());
+                EXPECT_EQ(key, value);
+                heap.pop();
+
+                for (int i = 0; i < 2; i++) {
+                        size_t next = value + 1 + rand() % 50;
+                        if (next > 1000 || heap.size() > 100)
+                                continue;
+                        queue.push(next, next);
+                        heap.push(next);
+                }
+        }
+        EXPECT_EQ(queue.empty(), true);
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "graphbin.h"
+
+using namespace std;
+
+TEST(GraphBin, checksum)
+{
+        const char *str = "ACGTACGTACGTGGATTCTTAGCCGTACGCCGA";
+        size_t len = strlen(str);
+
+        // checksumming in parts yields the same result
+        uint64_t full = graphBinChecksum(str, len);
+        uint64_t part = graphBinChecksum(str + 10, len - 10,
+                                         graphBinChecksum(str, 10));
+        EXPECT_EQ(full, part);
+        EXPECT_EQ(graphBinChecksum(NULL, 0), GRAPHBIN_CHECKSUM_SEED);
+
+        // a single flipped bit changes the checksum
+        string copy(str);
+        copy[5] ^= 1;
+        EXPECT_NE(full, graphBinChecksum(copy.c_str(), len));
+}
+
+TEST(GraphBin, mappedFile)
+{
+        const char *filename = "graphbintest.tmp";
+        string contents("BRWNGRPH some binary graph contents");
+
+        ofstream ofs(filename, ios::binary);
+        ofs.write(contents.c_str(), contents.size());
+        ofs.close();
+
+        MappedFile file;
+        file.open(filename);
+        EXPECT_EQ(file.isOpen(), true);
+        EXPECT_EQ(file.getSize(), contents.size());
+        EXPECT_EQ(memcmp(file.getData(), contents.c_str(), contents.size()), 0);
+
+        // writes to the mapped memory do not reach the file
+        file.getData()[0] = 'X';
+        file.close();
+        EXPECT_EQ(file.isOpen(), false);
+
+        file.open(filename);
+        EXPECT_EQ(file.getData()[0], 'B');
+        file.close();
+
+        remove(filename);
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include "graphstats.h"
+
+using namespace std;
+
+TEST(GraphStatistics, lengthHistogram)
+{
+        GraphStatistics stats;
+        stats.reset(5);
+        stats.addNode(1, 10, 2.0);
+        stats.addNode(2, 30, 5.0);
+        stats.addNode(3, 10, 2.05);
+        stats.addNode(4, 50, 7.0);
+
+        EXPECT_EQ(stats.getNumNodes(), 4u);
+        EXPECT_EQ(stats.getTotalMarginalLength(), 100u);
+        EXPECT_EQ(stats.getN50(0), 30u);
+        EXPECT_EQ(stats.getMaxLength(2), 52u);
+
+        // nodes 1 and 3 share a length and a coverage bin
+        const map<size_t, GraphStatistics::CoverageBin>& covHist = stats.getCoverageHistogram();
+        EXPECT_EQ(covHist.size(), 3u);
+        EXPECT_EQ(covHist.begin()->second.numNodes, 2u);
+        EXPECT_EQ(covHist.begin()->second.sumLength, 20u);
+
+        // a merge: nodes 1 and 2 are replaced by node 1 of length 40
+        stats.removeNode(1);
+        stats.removeNode(2);
+        stats.addNode(1, 40, 4.0);
+        EXPECT_EQ(stats.contains(2), false);
+        EXPECT_EQ(stats.getNumNodes(), 3u);
+        EXPECT_EQ(stats.getTotalMarginalLength(), 100u);
+        EXPECT_EQ(stats.getN50(0), 40u);
+
+        vector<NodeID> nodeIDs;
+        stats.getLongestNodes(60, nodeIDs);
+        ASSERT_EQ(nodeIDs.size(), 2u);
+        EXPECT_EQ(nodeIDs[0], 4);
+        EXPECT_EQ(nodeIDs[1], 1);
+
+        stats.getLongestNodes(0, nodeIDs);
+        EXPECT_EQ(nodeIDs.empty(), true);
+}
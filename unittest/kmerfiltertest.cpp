@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include "kmerfilter.h"
+
+using namespace std;
+
+string randomKmer()
+{
+        string str;
+        for (size_t i = 0; i < Kmer::getK(); i++)
+                str.push_back("ACGT"[rand() % 4]);
+        return str;
+}
+
+TEST(KmerFilter, MembershipTest)
+{
+        srand(17);
+        Kmer::setWordSize(31);
+
+        // an empty filter contains nothing
+        KmerFilter filter;
+        EXPECT_FALSE(filter.contains(Kmer(randomKmer())));
+
+        // inserted kmers are always found
+        const size_t numKmers = 100000;
+        vector<Kmer> kmers;
+        for (size_t i = 0; i < numKmers; i++)
+                kmers.push_back(Kmer(randomKmer()));
+
+        filter.init(numKmers);
+        for (size_t i = 0; i < numKmers; i++)
+                filter.insert(kmers[i]);
+        for (size_t i = 0; i < numKmers; i++)
+                ASSERT_TRUE(filter.contains(kmers[i]));
+
+        // other kmers are rarely found
+        size_t numFalsePositives = 0;
+        for (size_t i = 0; i < numKmers; i++)
+                if (filter.contains(Kmer(randomKmer())))
+                        numFalsePositives++;
+        EXPECT_LT(numFalsePositives, numKmers / 100);
+
+        // init() clears the filter
+        filter.init(numKmers);
+        size_t numFound = 0;
+        for (size_t i = 0; i < numKmers; i++)
+                if (filter.contains(kmers[i]))
+                        numFound++;
+        EXPECT_EQ(numFound, 0u);
+}
@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <fstream>
+#include "essaMEM-master/sparseSA.hpp"
+#include "essaMEM-master/parallelSA.hpp"
+
+using namespace std;
+
+extern "C" { void suffixsort(int *x, int *p, int n, int k, int l); }
+extern "C" { void suffixsort64(long *x, long *p, long n, long k, long l); }
+
+// random sequences with repeats (long LCP values)
+static packed_text createReference()
+{
+        srand(5);
+        packed_text ref;
+        while (ref.size() < 300000) {
+                string seq;
+                for (int i = 0; i < 500; i++)
+                        seq.push_back("ACGT"[rand() % 4]);
+                ref.append(seq);
+                if (rand() % 4 == 0)
+                        ref.append(seq.substr(0, 400));
+        }
+        return ref;
+}
+
+static void compareConstruction(long K)
+{
+        packed_text ref1 = createReference(), ref4 = ref1;
+        vector<string> descr(1, "");
+        vector<long> startpos(1, 0);
+
+        sparseSA sa1(ref1, descr, startpos, false, K, true, true, true, 1, 10, false, false, false);
+        sparseSA sa4(ref4, descr, startpos, false, K, true, true, true, 1, 10, false, false, false);
+        sa1.construct(1);
+        sa4.construct(4);
+
+        ASSERT_EQ(sa1.SA.size(), sa4.SA.size());
+        EXPECT_TRUE(sa1.SA == sa4.SA);
+        EXPECT_TRUE(sa1.ISA == sa4.ISA);
+        EXPECT_TRUE(sa1.LCP.vec == sa4.LCP.vec);
+        ASSERT_EQ(sa1.LCP.M.size(), sa4.LCP.M.size());
+        EXPECT_GT(sa1.LCP.M.size(), 0u);
+        for (size_t i = 0; i < sa1.LCP.M.size(); i++) {
+                EXPECT_EQ(sa1.LCP.M[i].idx, sa4.LCP.M[i].idx);
+                EXPECT_EQ(sa1.LCP.M[i].val, sa4.LCP.M[i].val);
+        }
+        EXPECT_TRUE(sa1.CHILD == sa4.CHILD);
+}
+
+TEST(sparseSA, parallelConstruction)
+{
+        compareConstruction(1);
+        compareConstruction(3);
+}
+
+TEST(sparseSA, packedText)
+{
+        srand(7);
+        packed_text packed;
+        string plain;
+        for (int i = 0; i < 100; i++) {
+                string seq, rc;
+                for (int j = rand() % 150; j > 0; j--)
+                        seq.push_back("ACGT"[rand() % 4]);
+                for (int j = seq.size() - 1; j >= 0; j--)
+                        rc.push_back("TGCA"[BITADD[(unsigned char)seq[j]]]);
+                packed.append(seq);
+                plain.append(seq + ">" + rc + ">");
+        }
+        packed.pad(3);
+        plain.append("$$$");
+
+        ASSERT_EQ(packed.length(), (long)plain.size());
+        for (long i = 0; i < packed.length(); i++)
+                ASSERT_EQ(packed[i], plain[i]);
+        EXPECT_EQ(packed.substr(1000, 80), plain.substr(1000, 80));
+        EXPECT_EQ(packed.substr(plain.size() - 5, 80), plain.substr(plain.size() - 5));
+}
+
+TEST(sparseSA, indexWidth)
+{
+        EXPECT_EQ(vec_index::width_for(1000), 4);
+        EXPECT_EQ(vec_index::width_for(5000000000l), 5);
+        EXPECT_EQ(vec_index::width_for(1l << 40), 8);
+
+        for (int width = 4; width <= 8; width += (width == 4) ? 1 : 3) {
+                vec_index v;
+                v.set_width(width);
+                v.resize(3);
+                long big = (width == 4) ? 2000000000l : 500000000000l;
+                v.set(0, -1);
+                v.set(1, big);
+                v.set(2, 7);
+                EXPECT_EQ(v[0], -1);
+                EXPECT_EQ(v[1], big);
+                EXPECT_EQ(v[2], 7);
+        }
+}
+
+TEST(sparseSA, longIndexSort)
+{
+        packed_text ref = createReference();
+        long n = ref.size();
+        vector<int> x(n+1), p(n+1);
+        vector<long> xl(n+1), pl(n+1);
+        for (long i = 0; i < n; i++)
+                x[i] = xl[i] = (ref[i] == '>') ? 1 : 2 + (ref[i] & 6) / 2;
+
+        parallelSuffixSort(&x[0], &p[0], n, 6, 2);
+        parallelSuffixSort(&xl[0], &pl[0], n, 6, 2);
+        for (long i = 0; i <= n; i++) {
+                ASSERT_EQ(p[i], pl[i]);
+                ASSERT_EQ(x[i], xl[i]);
+        }
+}
+
+TEST(sparseSA, longQsufsort)
+{
+        packed_text ref = createReference();
+        long n = ref.size();
+        vector<int> x(n+1), p(n+1);
+        vector<long> xl(n+1), pl(n+1);
+        for (long i = 0; i < n; i++)
+                x[i] = xl[i] = (ref[i] == '>') ? 1 : 2 + (ref[i] & 6) / 2;
+
+        suffixsort(&x[0], &p[0], n, 6, 1);
+        suffixsort64(&xl[0], &pl[0], n, 6, 1);
+        for (long i = 0; i <= n; i++) {
+                ASSERT_EQ(p[i], pl[i]);
+                ASSERT_EQ(x[i], xl[i]);
+        }
+}
+
+TEST(sparseSA, saveLoad)
+{
+        const string prefix = "sparsesatest.tmp";
+        packed_text ref1 = createReference(), ref2 = ref1, ref3 = ref1;
+        vector<string> descr(1, "");
+        vector<long> startpos(1, 0);
+
+        sparseSA sa1(ref1, descr, startpos, false, 3, true, true, true, 1, 10, false, false, false);
+        sa1.construct(1);
+        ASSERT_TRUE(sa1.save(prefix));
+
+        sparseSA sa2(ref2, descr, startpos, false, 3, true, true, true, 1, 10, false, false, false);
+        ASSERT_TRUE(sa2.load(prefix));
+        EXPECT_TRUE(sa2.SA == sa1.SA);
+        EXPECT_TRUE(sa2.LCP.vec == sa1.LCP.vec);
+        EXPECT_EQ(sa2.LCP.M.size(), sa1.LCP.M.size());
+
+        // a truncated LCP file leaves the index unchanged, so that it can
+        // still be constructed
+        ifstream ifs((prefix + ".lcp").c_str(), ios::binary);
+        string lcp((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+        ifs.close();
+        ofstream ofs((prefix + ".lcp").c_str(), ios::binary);
+        ofs.write(lcp.c_str(), lcp.size() / 2);
+        ofs.close();
+
+        sparseSA sa3(ref3, descr, startpos, false, 3, true, true, true, 1, 10, false, false, false);
+        EXPECT_FALSE(sa3.load(prefix));
+        EXPECT_EQ(sa3.SA.size(), 0u);
+        sa3.construct(1);
+        EXPECT_TRUE(sa3.SA == sa1.SA);
+        ASSERT_EQ(sa3.LCP.M.size(), sa1.LCP.M.size());
+        for (size_t i = 0; i < sa1.LCP.M.size(); i++)
+                EXPECT_EQ(sa3.LCP.M[i].val, sa1.LCP.M[i].val);
+
+        const char *ext[] = {".aux", ".sa", ".lcp", ".isa", ".child", ".kmer"};
+        for (size_t i = 0; i < sizeof(ext) / sizeof(ext[0]); i++)
+                remove((prefix + ext[i]).c_str());
+}
@@ -0,0 +1,32 @@
+#include <gtest/gtest.h>
+#include "traversal.h"
+
+using namespace std;
+
+TEST(TraversalWorkspace, epochReset)
+{
+        TraversalWorkspace ws(10);
+
+        ws.reset();
+        ws.visit(-3, 5, 7);
+        ws.visit(4, -3, 7);
+
+        EXPECT_EQ(ws.isVisited(-3), true);
+        EXPECT_EQ(ws.isVisited(3), false);
+        EXPECT_EQ(ws.getPrevNode(4), -3);
+        EXPECT_EQ(ws.getColor(-3), 7);
+        EXPECT_EQ(ws.getVisited().size(), 2u);
+
+        // a new traversal sees no visited nodes without clearing the arrays
+        ws.reset();
+        EXPECT_EQ(ws.isVisited(-3), false);
+        EXPECT_EQ(ws.getPrevNode(4), 0);
+        EXPECT_EQ(ws.getColor(-3), 0);
+        EXPECT_EQ(ws.getVisited().size(), 0u);
+
+        // resizing starts from scratch
+        ws.visit(10, 1, 1);
+        ws.resize(20);
+        EXPECT_EQ(ws.getNumNodes(), 20);
+        EXPECT_EQ(ws.isVisited(10), false);
+}
@@ -147,3 +147,100 @@ TEST(TString, revComplTest)
 
         EXPECT_EQ(Nucleotide::getRevCompl(source) == tstring.getSequence(), true);
 }
+
+TEST(TString, pooledSequence)
+{
+        string source1("ACGTACGTACGTGGATTCTTAGCCGTACGCCGA");
+        string source2("GGATTCTTAGCCGTACGCCGAACGTACGTACGTTTGCA");
+
+        // small slabs to force the creation of multiple slabs
+        SequencePool pool(16);
+        TString tStr1, tStr2;
+        tStr1.setSequence(source1, pool);
+        tStr2.setSequence(source2, pool);
+
+        EXPECT_EQ(tStr1.isPooled(), true);
+        EXPECT_EQ(tStr1.getSequence(), source1);
+        EXPECT_EQ(tStr2.getSequence(), source2);
+        EXPECT_EQ(pool.getNumSlabs(), 2u);
+        EXPECT_EQ(pool.getNumBytesAllocated(), 9u + 10);
+
+        // a longer sequence gets a fresh slice, the old one becomes dead
+        tStr1.setSequence(source1 + source2, pool);
+        EXPECT_EQ(tStr1.getSequence(), source1 + source2);
+        EXPECT_EQ(pool.getNumBytesReleased(), 9u);
+
+        // a shorter sequence is stored in place
+        tStr1.setSequence(source1, pool);
+        EXPECT_EQ(tStr1.getSequence(), source1);
+        EXPECT_EQ(pool.getNumBytesReleased(), 9u + 9);
+        EXPECT_EQ(pool.getNumBytesAllocated(), 9u + 10 + 18);
+
+        // compaction: copy the live sequences to a fresh pool
+        SequencePool newPool(16);
+        tStr1.moveToPool(newPool);
+        tStr2.moveToPool(newPool);
+        pool.swap(newPool);
+        newPool.clear();
+
+        EXPECT_EQ(tStr1.getSequence(), source1);
+        EXPECT_EQ(tStr2.getSequence(), source2);
+        EXPECT_EQ(pool.getNumBytesLive(), 9u + 10);
+        EXPECT_EQ(pool.getNumBytesReleased(), 0u);
+
+        // an owned sequence no longer refers to the pool
+        tStr2.setSequence(source1);
+        EXPECT_EQ(tStr2.isPooled(), false);
+        EXPECT_EQ(tStr2.getSequence(), source1);
+}
+
+TEST(TString, sharedPoolSlice)
+{
+        string source1("ACGTACGTACGTGGATTCTTAGCCGTACGCCGA");
+        string source2("GGATTCTTAGCC");
+
+        SequencePool pool;
+        TString original;
+        original.setSequence(source1, pool);
+
+        // a clone refers to the same slice through a pool with shared slices
+        SequencePool clonePool;
+        clonePool.addBorrowedSlab(pool.getNumBytesLive(), true);
+        TString clone;
+        clone.setPooledSlice(const_cast<uint8_t*>(original.getData()),
+                             original.getLength());
+        EXPECT_EQ(clone.getSequence(), source1);
+
+        // modifying the clone must not touch the original
+        clone.setSequence(source2, clonePool);
+        EXPECT_EQ(clone.getSequence(), source2);
+        EXPECT_EQ(original.getSequence(), source1);
+        EXPECT_NE(clone.getData(), original.getData());
+}
+
+TEST(TString, copyPacked)
+{
+        // longer than 32 nucleotides to cover the word boundaries
+        string source("ACGTACGTACGTGGATTCTTAGCCGTACGCCGAGGATTCTTAGCCGTACGCCGAACGTT");
+        TString tStr(source);
+
+        for (size_t srcOff = 0; srcOff < 5; srcOff++) {
+                for (size_t dstOff = 0; dstOff < 5; dstOff++) {
+                        size_t len = source.size() - srcOff;
+                        uint8_t buf[32] = {0};
+
+                        // forward copy
+                        TString::copyPacked(tStr.getData(), srcOff, len, false, buf, dstOff);
+                        TString fwd;
+                        fwd.setPooledSlice(buf, dstOff + len);
+                        EXPECT_EQ(fwd.substr(dstOff, len), source.substr(srcOff));
+
+                        // reverse complement copy
+                        memset(buf, 0, sizeof(buf));
+                        TString::copyPacked(tStr.getData(), srcOff, len, true, buf, dstOff);
+                        TString rc;
+                        rc.setPooledSlice(buf, dstOff + len);
+                        EXPECT_EQ(rc.substr(dstOff, len), Nucleotide::getRevCompl(source.substr(srcOff)));
+                }
+        }
+}
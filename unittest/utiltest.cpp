@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "util.h"
+#include <cmath>
 
 TEST(poissonPDF, poissonPDFTest)
 {
@@ -8,3 +9,11 @@ TEST(poissonPDF, poissonPDFTest)
         EXPECT_DOUBLE_EQ(0, Util::poissonPDF(1000, 10));
         EXPECT_DOUBLE_EQ(0, Util::poissonPDF(10000, 10));
 }
+
+TEST(poissonPDF, logFactorialTest)
+{
+        // tabulated and computed values must be identical
+        EXPECT_EQ(0.0, Util::logFactorial(0));
+        EXPECT_EQ(lgamma(11), Util::logFactorial(10));
+        EXPECT_EQ(lgamma(1000001), Util::logFactorial(1000000));
+}